@@ -11,9 +11,15 @@ var time_multiplier: float = 0.0027778
 @export var corner_exclusion_length: int = 64
 ## Margin from sides when spawning enemies
 @export var side_margin: int = 20
+## Enemies alive at once. The enemy renderer reserves this many instances up front so spawn waves don't resize it mid-game.
+@export var max_enemy_count: int = 4096
+## Enemies the wave director may spawn in one frame. Larger waves are spread over the next frames.
+@export var max_spawns_per_frame: int = 64
+## Samples baked from each curve for the wave director
+@export var curve_sample_count: int = 256
 
-var time: float = 0.0
-var max_enemy_count: int
+const ENEMY_PREFABS: PackedStringArray = ["BugSmall", "BugHumanoid", "BugLarge"]
+const NOMINAL_FRAME_RATE: float = 60.0 # probability_curve was tuned as a spawn chance per frame at this rate
 
 @onready var world: FlecsWorld = $".."
 @onready var terrain: MeshInstance2D = $"../../Terrain"
@@ -24,68 +30,48 @@ func _ready() -> void:
 		push_warning("EnemySpawnManager: World node not found.")
 		return
 
-	max_enemy_count = enemies_multimesh.multimesh.instance_count
+	# The spawning itself is done by the native "Enemy Wave Director" system, from the schedule baked here
+	world.set_singleton_component("SpawnSchedule", _bake_spawn_schedule())
 
-func _process(delta: float) -> void:
-	time += delta
-	
-	var current_enemy_count = (world.get_singleton_component("EnemyCount"))
-	if current_enemy_count >= max_enemy_count:
-		return # Rendering limit reached; can't spawn any more
-	
-	var scaled_time: float = time * time_multiplier
-	var prob_curve_sample: float = probability_curve.sample_baked(scaled_time)
-	var should_spawn: bool = randf() < prob_curve_sample
-	if should_spawn:
-		var picked_enemy_type: String = _pick_enemy_type(scaled_time)
-		var spawn_position: Vector2 = _pick_spawn_position()
+	if not world.is_node_ready():
+		await world.ready # Entity renderers are set up once the world is ready, which is after its children
+	world.reserve_renderer_capacity(enemies_multimesh, max_enemy_count)
 
-		world.run_system("Prefab Instantiation", {
-			"prefab": picked_enemy_type,
-			"count": 1,
-			"transforms": [Transform2D(0, spawn_position)],
-		})
 
+## Spawns count extra enemies on top of the schedule, spread over frames by max_spawns_per_frame
+func spawn_burst(count: int) -> void:
+	world.set_singleton_component("SpawnSchedule", {"burst": count})
 
-func _pick_enemy_type(scaled_time: float) -> String:
-	var enemy_type_sample: float = enemy_type_curve.sample_baked(scaled_time) - randf()
-	if enemy_type_sample < 0.33:
-		return "BugSmall"
-	if enemy_type_sample < 0.67:
-		return "BugHumanoid"
-	return "BugLarge"
 
+func _bake_spawn_schedule() -> Dictionary:
+	var spawn_rate_samples := PackedFloat32Array()
+	var type_weight_samples := PackedFloat32Array()
+	for i in range(curve_sample_count):
+		var x: float = float(i) / float(max(curve_sample_count - 1, 1))
+		spawn_rate_samples.append(probability_curve.sample_baked(x) * NOMINAL_FRAME_RATE) # Spawns per second
 
-func _pick_spawn_position() -> Vector2:
-	if not terrain or not terrain.mesh:
-		return Vector2.ZERO
+		# Enemy types used to be picked by comparing enemy_type_curve(x) - randf() against 0.33 and 0.67. These are the
+		# chances of each outcome, in the order of ENEMY_PREFABS.
+		var type_sample: float = enemy_type_curve.sample_baked(x)
+		var small_weight: float = clampf(1.33 - type_sample, 0.0, 1.0)
+		var large_weight: float = clampf(type_sample - 0.67, 0.0, 1.0)
+		type_weight_samples.append(small_weight)
+		type_weight_samples.append(1.0 - small_weight - large_weight)
+		type_weight_samples.append(large_weight)
 
-	var size: Vector2 = terrain.mesh.size
-	var half_size: Vector2 = size / 2.0
-	var spawnable_width: float = max(size.x - float(corner_exclusion_length * 2), 0.0)
-	var spawnable_height: float = max(size.y - float(corner_exclusion_length * 2), 0.0)
+	var half_extents := Vector2.ZERO
+	if terrain and terrain.mesh:
+		half_extents = terrain.mesh.size / 2.0
 
-	var total_perimeter: float = 2 * spawnable_width + 2 * spawnable_height
-	if total_perimeter == 0.0:
-		return Vector2.ZERO
-
-	var pick: float = randf() * total_perimeter
-
-	if pick < spawnable_width: # Top edge
-		var x_pos: float = pick - (spawnable_width / 2.0)
-		return Vector2(x_pos, -half_size.y - side_margin)
-	pick -= spawnable_width
-	
-	if pick < spawnable_width: # Bottom edge
-		var x_pos: float = pick - (spawnable_width / 2.0)
-		return Vector2(x_pos, half_size.y + side_margin)
-	pick -= spawnable_width
-	
-	if pick < spawnable_height: # Left edge
-		var y_pos: float = pick - (spawnable_height / 2.0)
-		return Vector2(-half_size.x - side_margin, y_pos)
-	pick -= spawnable_height
-	
-	# Right edge
-	var y_pos: float = pick - (spawnable_height / 2.0)
-	return Vector2(half_size.x + side_margin, y_pos)
+	return {
+		"spawn_rate_samples": spawn_rate_samples,
+		"type_weight_samples": type_weight_samples,
+		"prefabs": ENEMY_PREFABS,
+		"curve_time_scale": time_multiplier,
+		"half_extents": half_extents,
+		"corner_exclusion": corner_exclusion_length,
+		"side_margin": side_margin,
+		"max_enemy_count": max_enemy_count,
+		"max_spawns_per_frame": max_spawns_per_frame,
+		"seed": randi(),
+	}
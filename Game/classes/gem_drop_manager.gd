@@ -7,13 +7,14 @@ class_name GemDropManager extends Node
 @onready var world: FlecsWorld = $".."
 
 func _ready() -> void:
-	world.flecs_signal_emitted.connect(_on_flecs_signal)
+	world.subscribe_events("enemy_died", _on_enemies_died)
 
 
-func _on_flecs_signal(signal_name: StringName, data: Dictionary) -> void:
-	if signal_name == "enemy_died":
-		var drop_chance := drop_probabilities[data.get("enemy_type")]
+func _on_enemies_died(positions: PackedVector2Array, prefab_indices: PackedInt32Array, _amounts: PackedFloat32Array) -> void:
+	var prefab_names: PackedStringArray = world.get_event_prefab_names()
+	for i in positions.size():
+		var drop_chance: float = drop_probabilities.get(prefab_names[prefab_indices[i]], 0.0)
 		if randf() < drop_chance:
 			var gem = gem_scene.instantiate() as Node2D
-			gem.global_position = data.enemy_position
+			gem.global_position = positions[i]
 			add_child(gem)
@@ -12,8 +12,9 @@ var minimap_material: ShaderMaterial
 var stage: Stage
 var stage_bounds: Rect2
 var world: FlecsWorld
+var player_position_handle: int = -1
 var camera_node: Camera2D
-var enemy_multimesh: MultiMesh
+var enemies_instance: MultiMeshInstance2D
 var minimap_ready: bool = false
 var cached_altar_points: PackedVector2Array = PackedVector2Array()
 var cached_altar_states: PackedFloat32Array = PackedFloat32Array()
@@ -43,9 +44,10 @@ func _initialise_minimap() -> void:
 		return
 	stage_bounds = stage.get_stage_bounds()
 	world = stage.world
+	if world != null:
+		player_position_handle = world.get_singleton_handle("PlayerPosition")
 	camera_node = stage.get_node_or_null("Camera")
-	var enemies_instance: MultiMeshInstance2D = stage.get_node_or_null("World/Enemies")
-	enemy_multimesh = enemies_instance.multimesh if enemies_instance else null
+	enemies_instance = stage.get_node_or_null("World/Enemies")
 	cached_altar_points = _build_altar_points(stage.get_altar_positions())
 	cached_altar_states = _build_altar_states(stage.get_altar_states())
 	minimap_material.set_shader_parameter("altar_points", cached_altar_points)
@@ -69,7 +71,7 @@ func _update_player_marker() -> void:
 	if world == null:
 		minimap_material.set_shader_parameter("player_visible", 0.0)
 		return
-	var player_variant: Variant = world.get_singleton_component("PlayerPosition")
+	var player_variant: Variant = world.get_singleton_by_handle(player_position_handle)
 	if player_variant is Vector2 and stage_bounds.size != Vector2.ZERO:
 		var player_position: Vector2 = player_variant
 		minimap_material.set_shader_parameter("player_point", _normalise_point(player_position))
@@ -127,21 +129,12 @@ func _update_altar_markers() -> void:
 
 
 func _sample_enemy_positions() -> PackedVector2Array:
-	var positions := PackedVector2Array()
-	if enemy_multimesh == null or stage_bounds.size == Vector2.ZERO:
-		return positions
-	var visible_count: int = enemy_multimesh.visible_instance_count
-	if visible_count <= 0 or visible_count > enemy_multimesh.instance_count:
-		visible_count = enemy_multimesh.instance_count
-	if visible_count <= 0:
-		return positions
-	var ratio: float = float(visible_count) / float(MAX_ENEMY_SAMPLES)
-	var stride: int = max(int(ceil(ratio)), 1)
-	for instance_index in range(0, visible_count, stride):
-		var transform: Transform2D = enemy_multimesh.get_instance_transform_2d(instance_index)
-		positions.append(_normalise_point(transform.origin))
-		if positions.size() >= MAX_ENEMY_SAMPLES:
-			break
+	if world == null or enemies_instance == null or stage_bounds.size == Vector2.ZERO:
+		return PackedVector2Array()
+	# Sampled from the ECS rather than the MultiMesh, which only holds the enemies on screen
+	var positions := world.sample_renderer_positions(enemies_instance, MAX_ENEMY_SAMPLES)
+	for i in range(positions.size()):
+		positions[i] = _normalise_point(positions[i])
 	return positions
 
 
@@ -3,7 +3,8 @@ class_name ProjectileManager extends Node
 @export var projectile_global_node_group_name: String = "Projectiles"
 @export var singleton_component_name: String = "ProjectileData"
 
-var projectile_positions: Array[Vector2] = []
+var projectile_positions: PackedVector2Array = PackedVector2Array()
+var projectile_data_handle: int = -1
 
 @onready var world: FlecsWorld = get_node("../../World")
 @onready var upgrade_manager: UpgradeManager = $"../UpgradeManager"
@@ -12,6 +13,7 @@ func _ready() -> void:
 	if world == null:
 		push_warning("ProjectileManager: World node not found.")
 		return
+	projectile_data_handle = world.get_singleton_handle(singleton_component_name)
 
 
 func _process(delta: float) -> void:
@@ -27,6 +29,4 @@ func _process(delta: float) -> void:
 		if (projectile_node.spawn_position - projectile_node.global_position).length_squared() > projectile_node.range_squared:
 			projectile_node.queue_free()
 
-	world.set_singleton_component(singleton_component_name, {
-		"projectile_positions": projectile_positions
-	})
+	world.set_singleton_by_handle(projectile_data_handle, projectile_positions)
@@ -11,6 +11,7 @@ var has_played_sound: bool = false
 var max_radius: float = 0.5
 var active_radius: float = 0.0
 var mesh_size: float = 0.0
+var shockwave_data_handle: int = -1
 
 @onready var world: FlecsWorld = get_node("../../World")
 @onready var player: Player = $".."
@@ -43,6 +44,7 @@ func _ready() -> void:
 		return
 
 	mesh_size = quad_mesh.size.x * 0.5
+	shockwave_data_handle = world.get_singleton_handle(singleton_component_name)
 
 func _process(delta: float) -> void:
 	if not is_firing:
@@ -63,9 +65,7 @@ func _process(delta: float) -> void:
 	shader_material.set_shader_parameter("inner_ring", lerpf(inner_ring_range.x, inner_ring_range.y * upgrade_radius_multiplier, progress))
 	shader_material.set_shader_parameter("outer_ring", lerpf(outer_ring_range.x, outer_ring_range.y * upgrade_radius_multiplier, progress))
 
-	world.set_singleton_component(singleton_component_name, {
-		"radius": effective_radius * hit_radius_adjustment
-	})
+	world.set_singleton_by_handle(shockwave_data_handle, PackedFloat32Array([effective_radius * hit_radius_adjustment]))
 
 	if active_radius >= max_radius:
 		_reset_shockwave()
@@ -86,7 +86,5 @@ func _reset_shockwave() -> void:
 	active_radius = 0.0
 	is_firing = false
 	vfx.visible = false
-	world.set_singleton_component(singleton_component_name, {
-		"radius": 0.0
-	})
+	world.set_singleton_by_handle(shockwave_data_handle, PackedFloat32Array())
 	has_played_sound = false
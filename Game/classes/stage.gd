@@ -50,6 +50,7 @@ var _timer: Timer
 
 func _ready() -> void:
 	add_to_group("stage")
+	seed(world.sync_random_seed(randi())) # Logged by FlecsWorld input recordings so replays place the same scenery
 	
 	_connect_audio_manager_to_world()
 	
@@ -175,28 +176,28 @@ func _connect_audio_manager_to_world() -> void:
 
 
 func _spawn_initial_enemy_population() -> void:
+	var prefabs_to_spawn: Dictionary = {
+		"BugSmall": 17,
+		"BugHumanoid": 2,
+		"BugLarge": 1,
+	}
+	var positions_by_prefab: Dictionary = {}
+	for prefab in prefabs_to_spawn:
+		positions_by_prefab[prefab] = PackedVector2Array()
+
 	while spawn_iteration_counter < spawn_iterations:
-		var prefabs_to_spawn: Dictionary = {
-			"BugSmall": 17,
-			"BugHumanoid": 2,
-			"BugLarge": 1,
-		}
-		
 		for prefab in prefabs_to_spawn:
 			var count: int = prefabs_to_spawn[prefab]
-			var transforms: Array = []
-			
+			var positions: PackedVector2Array = positions_by_prefab[prefab]
 			for i in range(count):
-				var transform: Transform2D = _get_random_spawn_transform()
-				transforms.append(transform)
-
-			world.run_system("Prefab Instantiation", {
-				"prefab": prefab,
-				"count": count,
-				"transforms": transforms,
-			})
+				positions.append(_get_random_spawn_transform().origin)
+			positions_by_prefab[prefab] = positions
 		spawn_iteration_counter += 1
 
+	# One bulk spawn per prefab instead of one entity at a time
+	for prefab in positions_by_prefab:
+		world.spawn_batch(prefab, positions_by_prefab[prefab])
+
 
 func _get_random_spawn_transform() -> Transform2D:
 	var spawn_pos: Vector2
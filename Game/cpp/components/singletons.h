@@ -1,10 +1,21 @@
 #pragma once
 
+#include <cstdint>
+#include <utility>
+#include <vector>
+
 #include <godot_cpp/core/math_defs.hpp>
 #include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/packed_float32_array.hpp>
+#include <godot_cpp/variant/packed_string_array.hpp>
+#include <godot_cpp/variant/packed_vector2_array.hpp>
+#include <godot_cpp/variant/utility_functions.hpp>
+#include <godot_cpp/variant/vector2.hpp>
 
 #include "src/flecs_registry.h"
 #include "src/flecs_singleton_registry.h"
+#include "src/components/packed_channel.h"
+#include "src/utilities/world_snapshot.h"
 
 struct EnemyBoidMovementSettings {
     godot::real_t player_attraction_weight;
@@ -45,13 +56,11 @@ struct PlayerTakeDamageSettings {
     godot::real_t player_hit_radius;
 };
 
-struct ProjectileData {
-    godot::Dictionary value;
-};
+// Global positions of all live projectiles, written every frame as a PackedVector2Array.
+struct ProjectileData : PackedChannel<godot::Vector2> {};
 
-struct ShockwaveData {
-    godot::Dictionary value;
-};
+// Radii of the active shockwaves around the player, written as a PackedFloat32Array. Empty or zero when none is active.
+struct ShockwaveData : PackedChannel<float> {};
 
 struct EnemyCount
 {
@@ -63,6 +72,34 @@ struct EnemyCount
     }
 };
 
+// Drives the "Enemy Wave Director" system. Baked by EnemySpawnManager from its curves and the terrain: both curves are sampled
+// evenly over x in [0, 1], and x advances by elapsed seconds * curve_time_scale. The director accumulates
+// spawn_rate_samples (spawns per second) into spawn_debt and spawns whole enemies from it, at most max_spawns_per_frame a frame,
+// so a burst (added to spawn_debt) is spread over several frames instead of spiking one.
+// Enemies spawn on the terrain's perimeter, half_extents from its centre and side_margin outside, skipping corner_exclusion
+// at each corner.
+struct SpawnSchedule {
+    std::vector<float> spawn_rate_samples;
+    std::vector<float> type_weight_samples; // prefabs.size() weights per sample, sample-major
+    std::vector<flecs::entity> prefabs;
+    godot::real_t curve_time_scale = godot::real_t(0.0);
+    godot::Vector2 half_extents;
+    godot::real_t corner_exclusion = godot::real_t(0.0);
+    godot::real_t side_margin = godot::real_t(0.0);
+    int64_t max_enemy_count = 0;
+    int64_t max_spawns_per_frame = 0;
+
+    std::vector<std::vector<godot::Vector2>> positions_by_prefab; // Scratch, kept to reuse its capacity
+};
+
+// Where the "Enemy Wave Director" is along the SpawnSchedule. Captured by world snapshots, so a restored stage resumes the
+// waves from the snapshot.
+struct SpawnDirectorState {
+    double elapsed = 0.0;
+    double spawn_debt = 0.0;
+    uint64_t random_state = 0;
+};
+
 
 inline FlecsRegistry register_game_singleton_components([](flecs::world& world) {
     world.component<EnemyBoidMovementSettings>("EnemyBoidMovementSettings")
@@ -167,13 +204,77 @@ inline FlecsRegistry register_game_singleton_components([](flecs::world& world)
         world.set<EnemyTakeDamageSettings>(updated_settings);
     });
 
-    register_singleton_getter<EnemyCount>("EnemyCount");
+    world.component<SpawnSchedule>("SpawnSchedule")
+        .add(flecs::Singleton)
+        .set<SpawnSchedule>({});
 
-    register_singleton_setter<godot::Dictionary>("ProjectileData", [](flecs::world& world, const godot::Dictionary& projectile_data) {
-        world.set<ProjectileData>({ projectile_data });
-    });
+    world.component<SpawnDirectorState>("SpawnDirectorState")
+        .add(flecs::Singleton)
+        .set<SpawnDirectorState>({});
+    include_in_snapshots<SpawnDirectorState>(world);
+
+    // Keys missing from the Dictionary keep their current values. "prefabs" is a PackedStringArray of prefab names, "burst" adds
+    // that many enemies to the spawn debt, "seed" restarts the director's random sequence.
+    register_singleton_setter<godot::Dictionary>("SpawnSchedule", [](flecs::world& world, const godot::Dictionary& schedule_settings) {
+        SpawnSchedule* schedule = world.try_get_mut<SpawnSchedule>();
+        SpawnDirectorState* director_state = world.try_get_mut<SpawnDirectorState>();
+        if (schedule == nullptr || director_state == nullptr) { return; }
+
+        // Resolved up front: the weight channels follow the names, so a schedule with a missing prefab is rejected whole
+        // instead of rolling spawns for it that never happen
+        std::vector<flecs::entity> prefabs;
+        if (schedule_settings.has("prefabs")) {
+            const godot::PackedStringArray prefab_names = schedule_settings["prefabs"];
+            for (int64_t prefab_idx = 0; prefab_idx < prefab_names.size(); ++prefab_idx) {
+                const flecs::entity prefab = world.lookup(prefab_names[prefab_idx].utf8().get_data());
+                if (!prefab) {
+                    godot::UtilityFunctions::push_error(godot::String("SpawnSchedule: prefab '") + prefab_names[prefab_idx] + "' not found, the schedule is not applied.");
+                    return;
+                }
+                prefabs.push_back(prefab);
+            }
+        }
 
-    register_singleton_setter<godot::Dictionary>("ShockwaveData", [](flecs::world& world, const godot::Dictionary& shockwave_data) {
-        world.set<ShockwaveData>({ shockwave_data });
+        if (schedule_settings.has("spawn_rate_samples")) {
+            const godot::PackedFloat32Array samples = schedule_settings["spawn_rate_samples"];
+            schedule->spawn_rate_samples.assign(samples.ptr(), samples.ptr() + samples.size());
+        }
+        if (schedule_settings.has("type_weight_samples")) {
+            const godot::PackedFloat32Array samples = schedule_settings["type_weight_samples"];
+            schedule->type_weight_samples.assign(samples.ptr(), samples.ptr() + samples.size());
+        }
+        if (schedule_settings.has("prefabs")) {
+            schedule->prefabs = std::move(prefabs);
+            schedule->positions_by_prefab.resize(schedule->prefabs.size());
+        }
+        if (schedule_settings.has("curve_time_scale")) {
+            schedule->curve_time_scale = static_cast<godot::real_t>(schedule_settings["curve_time_scale"]);
+        }
+        if (schedule_settings.has("half_extents")) {
+            schedule->half_extents = schedule_settings["half_extents"];
+        }
+        if (schedule_settings.has("corner_exclusion")) {
+            schedule->corner_exclusion = static_cast<godot::real_t>(schedule_settings["corner_exclusion"]);
+        }
+        if (schedule_settings.has("side_margin")) {
+            schedule->side_margin = static_cast<godot::real_t>(schedule_settings["side_margin"]);
+        }
+        if (schedule_settings.has("max_enemy_count")) {
+            schedule->max_enemy_count = static_cast<int64_t>(schedule_settings["max_enemy_count"]);
+        }
+        if (schedule_settings.has("max_spawns_per_frame")) {
+            schedule->max_spawns_per_frame = static_cast<int64_t>(schedule_settings["max_spawns_per_frame"]);
+        }
+        if (schedule_settings.has("seed")) {
+            director_state->random_state = static_cast<uint64_t>(static_cast<int64_t>(schedule_settings["seed"]));
+        }
+        if (schedule_settings.has("burst")) {
+            director_state->spawn_debt += static_cast<double>(static_cast<int64_t>(schedule_settings["burst"]));
+        }
     });
+
+    register_singleton_getter<EnemyCount>("EnemyCount");
+
+    register_packed_channel_setter<ProjectileData, godot::PackedVector2Array>("ProjectileData");
+    register_packed_channel_setter<ShockwaveData, godot::PackedFloat32Array>("ShockwaveData");
 });
@@ -11,4 +11,5 @@
 #include "systems/enemy_hit_player.h"
 #include "systems/enemy_animation.h"
 #include "systems/enemy_count_update.h"
+#include "systems/enemy_wave_director.h"
 #include "systems/velocity_to_position.h"
@@ -18,6 +18,17 @@ inline FlecsRegistry register_character2d_prefab([](flecs::world& world) {
         .set_auto_override<Rotation2D>({ 0.0f })
         .set_auto_override<Scale2D>({ godot::Vector2(1.0f, 1.0f) })
         .set_auto_override<godot::Transform2D>(godot::Transform2D())
+        .set_auto_override<PreviousTransform2D>({ godot::Transform2D() })
+
+        .set_auto_override<RenderingCustomData>({ 0.0f, 0.0f, 0.0f, 0.0f });
+
+    // For characters that never rotate or scale: no Transform2D to keep up to date, the renderer packs Position2D directly
+    world.prefab("TranslationOnlyCharacter2D")
+        .add<TranslationOnly2D>()
+        .set_auto_override<Velocity2D>({ godot::Vector2(0.0f, 0.0f) })
+
+        .set_auto_override<Position2D>({ godot::Vector2(0.0f, 0.0f) })
+        .set_auto_override<PreviousPosition2D>({ godot::Vector2(0.0f, 0.0f) })
 
         .set_auto_override<RenderingCustomData>({ 0.0f, 0.0f, 0.0f, 0.0f });
 });
@@ -7,7 +7,7 @@
 
 inline FlecsRegistry register_enemy_prefab([](flecs::world& world) {
     world.prefab("Enemy")
-        .is_a(world.lookup("Character2D"))
+        .is_a(world.lookup("TranslationOnlyCharacter2D"))
         .set_auto_override<HitPoints>({ godot::real_t(100.0) })
         .set_auto_override<HitRadius>({ godot::real_t(14.0) })
         .set_auto_override<MeleeDamage>({ godot::real_t(10.0) })
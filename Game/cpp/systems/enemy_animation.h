@@ -64,6 +64,7 @@ inline FlecsRegistry register_enemy_animation_system([](flecs::world& world) {
     world.system<const HitPoints, const Velocity2D, const MovementSpeed, const AnimationFrameOffset, const DeathTimer, const HitReactionTimer, HFlipTimer, VFlipTimer, RenderingCustomData>("Enemy Animation")
         .with(flecs::IsA, world.lookup("Enemy"))
         .kind(flecs::PostUpdate)
+        .multi_threaded()
         .run([](flecs::iter& it) {
         const EnemyAnimationSettings* animation_settings = it.world().try_get<EnemyAnimationSettings>();
         if (animation_settings == nullptr) {
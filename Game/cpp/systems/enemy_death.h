@@ -4,15 +4,13 @@
 #include <cstdint>
 #include <limits>
 
-#include <godot_cpp/variant/dictionary.hpp>
-#include <godot_cpp/variant/string.hpp>
 #include <godot_cpp/variant/vector2.hpp>
 
 #include "src/flecs_registry.h"
 
 #include "src/components/physics.h"
 #include "src/components/transform.h"
-#include "src/utilities/godot_signal.h"
+#include "src/utilities/godot_event_queue.h"
 
 #include "components/enemy.h"
 #include "components/singletons.h"
@@ -23,7 +21,10 @@ inline FlecsRegistry register_enemy_death_system([](flecs::world& world) {
         .kind(flecs::OnValidate)
         .run([](flecs::iter& it) {
         const EnemyAnimationSettings* animation_settings = it.world().try_get<EnemyAnimationSettings>();
-        if (animation_settings == nullptr) { return; }
+        GodotEventQueue* event_queue = it.world().try_get_mut<GodotEventQueue>();
+        if (animation_settings == nullptr || event_queue == nullptr) { return; }
+
+        GodotEventBatch& died_events = event_queue->get_batch("enemy_died");
 
         const godot::real_t death_animation_duration = animation_settings->animation_interval * animation_settings->death_animation_frame_count;
         const godot::real_t invulnerable_hit_points = kEnemyDeathInvulnerableHitPoints;
@@ -41,11 +42,8 @@ inline FlecsRegistry register_enemy_death_system([](flecs::world& world) {
                 if (hit_points[entity_index].value > godot::real_t(0.0)) { continue; }
 
                 flecs::entity entity = it.entity(static_cast<std::int32_t>(entity_index));
-                godot::Dictionary signal_data;
                 const flecs::entity prefab_entity = entity.target(flecs::IsA);
-                signal_data["enemy_type"] = godot::String(prefab_entity.name().c_str());
-                signal_data["enemy_position"] = positions[entity_index].value;
-                emit_godot_signal(it.world(), entity, "enemy_died", signal_data);
+                died_events.push(positions[entity_index].value, event_queue->get_prefab_index(prefab_entity), 0.0f);
 
                 hit_points[entity_index].value = invulnerable_hit_points;
                 death_timer[entity_index].value = death_animation_duration;
@@ -4,13 +4,12 @@
 #include <cstdint>
 
 #include <godot_cpp/core/math.hpp>
-#include <godot_cpp/variant/dictionary.hpp>
 #include <godot_cpp/variant/vector2.hpp>
 
 #include "src/flecs_registry.h"
 #include "src/components/transform.h"
 #include "src/components/player.h"
-#include "src/utilities/godot_signal.h"
+#include "src/utilities/godot_event_queue.h"
 
 #include "components/enemy.h"
 #include "components/singletons.h"
@@ -22,7 +21,8 @@ inline FlecsRegistry register_player_take_damage_system([](flecs::world& world)
         const PlayerPosition* player_position = it.world().try_get<PlayerPosition>();
         PlayerDamageCooldown* player_damage_cooldown = it.world().try_get_mut<PlayerDamageCooldown>();
         const PlayerTakeDamageSettings* damage_settings = it.world().try_get<PlayerTakeDamageSettings>();
-        if (player_position == nullptr || player_damage_cooldown == nullptr || damage_settings == nullptr) {
+        GodotEventQueue* event_queue = it.world().try_get_mut<GodotEventQueue>();
+        if (player_position == nullptr || player_damage_cooldown == nullptr || damage_settings == nullptr || event_queue == nullptr) {
             return;
         }
 
@@ -55,9 +55,10 @@ inline FlecsRegistry register_player_take_damage_system([](flecs::world& world)
                 }
 
                 flecs::entity damaging_enemy = it.entity(static_cast<std::int32_t>(entity_index));
-                godot::Dictionary signal_data;
-                signal_data["damage_amount"] = damage_amount;
-                emit_godot_signal(it.world(), damaging_enemy, "enemy_hit_player", signal_data);
+                event_queue->get_batch("enemy_hit_player").push(
+                    enemy_position,
+                    event_queue->get_prefab_index(damaging_enemy.target(flecs::IsA)),
+                    static_cast<float>(damage_amount));
 
                 player_damage_cooldown->value = godot::real_t(0.0);
                 return;
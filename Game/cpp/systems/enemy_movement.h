@@ -7,7 +7,6 @@
 
 #include <godot_cpp/core/math.hpp>
 #include <godot_cpp/variant/vector2.hpp>
-#include <godot_cpp/variant/utility_functions.hpp>
 
 #include "src/flecs_registry.h"
 #include "src/components/player.h"
@@ -22,17 +21,19 @@ namespace enemy_movement {
 
     struct BoidAccessor {
         flecs::entity_t entity_id;
-        godot::Vector2* position;
-        godot::Vector2* velocity;
-        godot::real_t max_speed;
+        const godot::Vector2* position;
     };
 
+    // Built single-threaded by "Enemy Movement Neighbour Index" and only read by the multi-threaded steering system,
+    // so workers can share it without locking.
     struct KdTreeCache {
         enemy_kd_tree::KdTree2D tree;
+        std::vector<BoidAccessor> boids;
         std::vector<godot::Vector2> cached_positions;
         std::vector<flecs::entity_t> cached_entity_ids;
         std::size_t cached_count = 0;
         std::uint32_t frames_since_rebuild = 0;
+        std::uint64_t frame_index = 0;
     };
 
     inline KdTreeCache& get_kd_tree_cache() {
@@ -67,59 +68,60 @@ namespace enemy_movement {
         return value * (godot::Math::sqrt(max_length_sq / current_length_sq));
     }
 
+    // Deterministic stand-in for randf_range(-intensity, intensity). Hashing the entity id with the frame index gives every
+    // boid its own noise sequence, so the result doesn't depend on which worker thread steers which rows.
+    inline godot::real_t separation_noise(flecs::entity_t entity_id, std::uint64_t frame_index, std::uint64_t axis, godot::real_t intensity) {
+        std::uint64_t state = entity_id ^ (frame_index * 0x9E3779B97F4A7C15ULL) ^ (axis << 32U);
+        state ^= state >> 30U;
+        state *= 0xBF58476D1CE4E5B9ULL;
+        state ^= state >> 27U;
+        state *= 0x94D049BB133111EBULL;
+        state ^= state >> 31U;
+
+        const godot::real_t unit_value = static_cast<godot::real_t>(state & 0xFFFFFFULL) / godot::real_t(16777215.0);
+        return (unit_value * godot::real_t(2.0) - godot::real_t(1.0)) * intensity;
+    }
+
 } // namespace enemy_movement
 
-inline FlecsRegistry register_enemy_movement_system([](flecs::world& world) {
-    world.system<Position2D, Velocity2D, const MovementSpeed, const DeathTimer>("Enemy Movement")
+// Rebuilds (or refreshes) the neighbour kd tree from this frame's positions. It has to see every boid, so it stays on the
+// main thread and runs right before the steering system in the same phase.
+inline FlecsRegistry register_enemy_movement_neighbour_index_system([](flecs::world& world) {
+    world.system<const Position2D, const DeathTimer>("Enemy Movement Neighbour Index")
         .with(flecs::IsA, world.lookup("Enemy"))
         .run([](flecs::iter& it) {
         flecs::world stage_world = it.world();
-        const PlayerPosition* player_position = stage_world.try_get<PlayerPosition>();
         const EnemyBoidMovementSettings* movement_settings = stage_world.try_get<EnemyBoidMovementSettings>();
 
-        if (player_position == nullptr || movement_settings == nullptr) {
+        if (movement_settings == nullptr) {
             return;
         }
 
         enemy_movement::KdTreeCache& kd_cache = enemy_movement::get_kd_tree_cache();
+        kd_cache.frame_index += 1;
 
-        std::vector<enemy_movement::BoidAccessor> boids;
-        const std::size_t suggested_capacity = kd_cache.cached_count > 0 ? kd_cache.cached_count : static_cast<std::size_t>(256U);
-        boids.reserve(suggested_capacity);
-
-        godot::real_t delta_time = 0.0f;
-        bool delta_time_initialized = false;
+        std::vector<enemy_movement::BoidAccessor>& boids = kd_cache.boids;
+        boids.clear();
 
         while (it.next()) {
-            if (!delta_time_initialized) {
-                delta_time = it.delta_time();
-                delta_time_initialized = true;
-            }
-
-            flecs::field<Position2D> positions = it.field<Position2D>(0);
-            flecs::field<Velocity2D> velocities = it.field<Velocity2D>(1);
-            flecs::field<const MovementSpeed> movement_speeds = it.field<const MovementSpeed>(2);
-            flecs::field<const DeathTimer> death_timers = it.field<const DeathTimer>(3);
-
-            const godot::real_t max_speed_multiplier = movement_settings->max_speed_multiplier;
+            flecs::field<const Position2D> positions = it.field<const Position2D>(0);
+            flecs::field<const DeathTimer> death_timers = it.field<const DeathTimer>(1);
 
             for (size_t row_index = 0; row_index < it.count(); ++row_index) {
                 if (death_timers[row_index].value > 0.0f) {
                     continue;
                 }
                 const flecs::entity current_entity = it.entity(static_cast<int32_t>(row_index));
-                enemy_movement::BoidAccessor accessor{
-                    current_entity.id(),
-                    &positions[row_index].value,
-                    &velocities[row_index].value,
-                    godot::Math::max(movement_speeds[row_index].value * max_speed_multiplier, 1.0f)
-                };
-                boids.push_back(accessor);
+                boids.push_back(enemy_movement::BoidAccessor{ current_entity.id(), &positions[row_index].value });
             }
         }
 
         const size_t enemy_count = boids.size();
         if (enemy_count == 0) {
+            kd_cache.tree.clear();
+            kd_cache.cached_positions.clear();
+            kd_cache.cached_entity_ids.clear();
+            kd_cache.cached_count = 0;
             return;
         }
 
@@ -127,14 +129,6 @@ inline FlecsRegistry register_enemy_movement_system([](flecs::world& world) {
             return lhs.entity_id < rhs.entity_id;
         });
 
-        const godot::real_t neighbor_radius_sq = movement_settings->neighbor_radius * movement_settings->neighbor_radius;
-        const godot::real_t separation_radius_sq = movement_settings->separation_radius * movement_settings->separation_radius;
-        const godot::real_t max_force = movement_settings->max_force;
-        const godot::real_t player_engage_radius_sq = movement_settings->player_engage_distance * movement_settings->player_engage_distance;
-        const std::int32_t neighbor_sample_limit = movement_settings->max_neighbor_sample_count <= godot::real_t(0.0)
-            ? -1
-            : static_cast<std::int32_t>(movement_settings->max_neighbor_sample_count);
-
         struct BoidPositionAccessor {
             const std::vector<enemy_movement::BoidAccessor>* boid_array;
 
@@ -198,82 +192,122 @@ inline FlecsRegistry register_enemy_movement_system([](flecs::world& world) {
             kd_cache.cached_entity_ids[index] = boids[index].entity_id;
         }
         kd_cache.cached_count = enemy_count;
+    });
+});
+
+// Steering only reads the shared kd tree and writes the velocity of its own rows, so it can be split across worker threads.
+inline FlecsRegistry register_enemy_movement_system([](flecs::world& world) {
+    world.system<const Position2D, Velocity2D, const MovementSpeed, const DeathTimer>("Enemy Movement")
+        .with(flecs::IsA, world.lookup("Enemy"))
+        .multi_threaded()
+        .run([](flecs::iter& it) {
+        flecs::world stage_world = it.world();
+        const PlayerPosition* player_position = stage_world.try_get<PlayerPosition>();
+        const EnemyBoidMovementSettings* movement_settings = stage_world.try_get<EnemyBoidMovementSettings>();
+
+        if (player_position == nullptr || movement_settings == nullptr) {
+            return;
+        }
+
+        const enemy_movement::KdTreeCache& kd_cache = enemy_movement::get_kd_tree_cache();
+
+        const godot::real_t separation_radius_sq = movement_settings->separation_radius * movement_settings->separation_radius;
+        const godot::real_t max_force = movement_settings->max_force;
+        const godot::real_t max_speed_multiplier = movement_settings->max_speed_multiplier;
+        const godot::real_t noise_intensity = movement_settings->separation_noise_intensity;
+        const godot::real_t player_engage_radius_sq = movement_settings->player_engage_distance * movement_settings->player_engage_distance;
+        const std::int32_t neighbor_sample_limit = movement_settings->max_neighbor_sample_count <= godot::real_t(0.0)
+            ? -1
+            : static_cast<std::int32_t>(movement_settings->max_neighbor_sample_count);
 
-        for (size_t entity_index = 0; entity_index < enemy_count; ++entity_index) {
-            const godot::Vector2 position_value = *boids[entity_index].position;
-            const godot::Vector2 current_velocity = *boids[entity_index].velocity;
-            const godot::real_t max_speed = boids[entity_index].max_speed;
-
-            godot::Vector2 separation_sum = godot::Vector2(0.0f, 0.0f);
-            std::int32_t separation_count = 0;
-
-            struct NeighborAccumulator {
-                const std::vector<enemy_movement::BoidAccessor>* boid_array;
-                const godot::Vector2& origin;
-                std::size_t self_index;
-                godot::real_t separation_radius_squared;
-                godot::Vector2& separation_sum_ref;
-                std::int32_t& separation_count_ref;
-
-                void operator()(std::int32_t other_index, const godot::Vector2& other_position, godot::real_t distance_squared) const {
-                    const std::size_t other_offset = static_cast<std::size_t>(other_index);
-                    if (other_offset == self_index || distance_squared == 0.0f) {
-                        return;
-                    }
-
-                    if (distance_squared < separation_radius_squared) {
-                        const godot::Vector2 offset = other_position - origin;
-                        separation_sum_ref -= offset / distance_squared;
-                        separation_count_ref += 1;
-                    }
+        struct NeighborAccumulator {
+            const std::vector<flecs::entity_t>* entity_ids;
+            const godot::Vector2& origin;
+            flecs::entity_t self_id;
+            godot::real_t separation_radius_squared;
+            godot::Vector2& separation_sum_ref;
+            std::int32_t& separation_count_ref;
+
+            void operator()(std::int32_t other_index, const godot::Vector2& other_position, godot::real_t distance_squared) const {
+                const std::size_t other_offset = static_cast<std::size_t>(other_index);
+                if ((*entity_ids)[other_offset] == self_id || distance_squared == 0.0f) {
+                    return;
                 }
-            };
-
-            NeighborAccumulator accumulator{
-                &boids,
-                position_value,
-                entity_index,
-                separation_radius_sq,
-                separation_sum,
-                separation_count
-            };
-
-            kd_cache.tree.radius_query(position_value, separation_radius_sq, accumulator, neighbor_sample_limit);
-
-            godot::Vector2 separation_force = godot::Vector2(0.0f, 0.0f);
-            if (separation_count > 0) {
-                const godot::Vector2 average_push = separation_sum / static_cast<godot::real_t>(separation_count);
-
-                // Add noise to break up rows/columns
-                const double noise_intensity = static_cast<double>(movement_settings->separation_noise_intensity);
-                const godot::Vector2 noise(
-                    static_cast<float>(godot::UtilityFunctions::randf_range(-noise_intensity, noise_intensity)),
-                    static_cast<float>(godot::UtilityFunctions::randf_range(-noise_intensity, noise_intensity))
-                );
-
-                separation_force = enemy_movement::steer_towards(average_push + noise, current_velocity, max_speed);
-            }
 
-            const godot::Vector2 player_offset = player_position->value - position_value;
-            godot::Vector2 player_force = enemy_movement::steer_towards(player_offset, current_velocity, max_speed);
-            const godot::real_t distance_to_player_sq = player_offset.length_squared();
-            if (distance_to_player_sq < player_engage_radius_sq && player_engage_radius_sq > 0.0f) {
-                const godot::real_t distance_to_player = godot::Math::sqrt(distance_to_player_sq);
-                const godot::real_t normalized_distance = distance_to_player / movement_settings->player_engage_distance;
-                const godot::real_t slowdown_factor = godot::Math::clamp(normalized_distance, 0.2f, 1.0f);
-                player_force *= slowdown_factor;
+                if (distance_squared < separation_radius_squared) {
+                    const godot::Vector2 offset = other_position - origin;
+                    separation_sum_ref -= offset / distance_squared;
+                    separation_count_ref += 1;
+                }
             }
+        };
+
+        while (it.next()) {
+            const godot::real_t delta_time = it.delta_time();
+
+            flecs::field<const Position2D> positions = it.field<const Position2D>(0);
+            flecs::field<Velocity2D> velocities = it.field<Velocity2D>(1);
+            flecs::field<const MovementSpeed> movement_speeds = it.field<const MovementSpeed>(2);
+            flecs::field<const DeathTimer> death_timers = it.field<const DeathTimer>(3);
+
+            for (size_t row_index = 0; row_index < it.count(); ++row_index) {
+                if (death_timers[row_index].value > 0.0f || kd_cache.tree.empty()) {
+                    continue;
+                }
+
+                const flecs::entity_t entity_id = it.entity(static_cast<int32_t>(row_index)).id();
+                const godot::Vector2 position_value = positions[row_index].value;
+                const godot::Vector2 current_velocity = velocities[row_index].value;
+                const godot::real_t max_speed = godot::Math::max(movement_speeds[row_index].value * max_speed_multiplier, 1.0f);
+
+                godot::Vector2 separation_sum = godot::Vector2(0.0f, 0.0f);
+                std::int32_t separation_count = 0;
+
+                NeighborAccumulator accumulator{
+                    &kd_cache.cached_entity_ids,
+                    position_value,
+                    entity_id,
+                    separation_radius_sq,
+                    separation_sum,
+                    separation_count
+                };
 
-            godot::Vector2 acceleration = godot::Vector2(0.0f, 0.0f);
-            acceleration += separation_force * movement_settings->separation_weight;
-            acceleration += player_force * movement_settings->player_attraction_weight;
+                kd_cache.tree.radius_query(position_value, separation_radius_sq, accumulator, neighbor_sample_limit);
 
-            acceleration = enemy_movement::limit_vector_squared(acceleration, max_force * max_force);
+                godot::Vector2 separation_force = godot::Vector2(0.0f, 0.0f);
+                if (separation_count > 0) {
+                    const godot::Vector2 average_push = separation_sum / static_cast<godot::real_t>(separation_count);
 
-            godot::Vector2 new_velocity = current_velocity + acceleration * delta_time;
-            new_velocity = enemy_movement::limit_vector_squared(new_velocity, max_speed * max_speed);
+                    // Add noise to break up rows/columns
+                    const godot::Vector2 noise(
+                        enemy_movement::separation_noise(entity_id, kd_cache.frame_index, 0U, noise_intensity),
+                        enemy_movement::separation_noise(entity_id, kd_cache.frame_index, 1U, noise_intensity)
+                    );
 
-            *boids[entity_index].velocity = new_velocity;
+                    separation_force = enemy_movement::steer_towards(average_push + noise, current_velocity, max_speed);
+                }
+
+                const godot::Vector2 player_offset = player_position->value - position_value;
+                godot::Vector2 player_force = enemy_movement::steer_towards(player_offset, current_velocity, max_speed);
+                const godot::real_t distance_to_player_sq = player_offset.length_squared();
+                if (distance_to_player_sq < player_engage_radius_sq && player_engage_radius_sq > 0.0f) {
+                    const godot::real_t distance_to_player = godot::Math::sqrt(distance_to_player_sq);
+                    const godot::real_t normalized_distance = distance_to_player / movement_settings->player_engage_distance;
+                    const godot::real_t slowdown_factor = godot::Math::clamp(normalized_distance, 0.2f, 1.0f);
+                    player_force *= slowdown_factor;
+                }
+
+                godot::Vector2 acceleration = godot::Vector2(0.0f, 0.0f);
+                acceleration += separation_force * movement_settings->separation_weight;
+                acceleration += player_force * movement_settings->player_attraction_weight;
+
+                acceleration = enemy_movement::limit_vector_squared(acceleration, max_force * max_force);
+
+                godot::Vector2 new_velocity = current_velocity + acceleration * delta_time;
+                new_velocity = enemy_movement::limit_vector_squared(new_velocity, max_speed * max_speed);
+
+                velocities[row_index].value = new_velocity;
+            }
         }
     });
 });
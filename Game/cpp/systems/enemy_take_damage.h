@@ -4,16 +4,12 @@
 #include <vector>
 
 #include <godot_cpp/core/math.hpp>
-#include <godot_cpp/variant/array.hpp>
-#include <godot_cpp/variant/dictionary.hpp>
-#include <godot_cpp/variant/string.hpp>
-#include <godot_cpp/variant/variant.hpp>
 #include <godot_cpp/variant/vector2.hpp>
 
 #include "src/flecs_registry.h"
 #include "src/components/transform.h"
 #include "src/components/player.h"
-#include "src/utilities/godot_signal.h"
+#include "src/utilities/godot_event_queue.h"
 
 #include "components/enemy.h"
 #include "components/singletons.h"
@@ -31,42 +27,16 @@ namespace enemy_take_damage {
         flecs::entity entity;
     };
 
-    inline godot::Array get_projectile_positions(const ProjectileData* projectile_data) {
-        if (projectile_data == nullptr) {
-            return godot::Array();
-        }
-
-        const godot::StringName positions_key = "projectile_positions";
-
-        if (!projectile_data->value.has(positions_key)) {
-            return godot::Array();
-        }
-
-        const godot::Variant positions_variant = projectile_data->value.get(positions_key, godot::Variant());
-        if (positions_variant.get_type() != godot::Variant::ARRAY) {
-            return godot::Array();
-        }
-
-        return positions_variant;
-    }
-
     inline godot::real_t get_shockwave_radius(const ShockwaveData* shockwave_data) {
         if (shockwave_data == nullptr) {
             return godot::real_t(0.0);
         }
 
-        static const godot::StringName radius_key = "radius";
-        if (!shockwave_data->value.has(radius_key)) {
-            return godot::real_t(0.0);
-        }
-
-        const godot::Variant radius_variant = shockwave_data->value.get(radius_key, godot::Variant());
-        if (radius_variant.get_type() == godot::Variant::FLOAT || radius_variant.get_type() == godot::Variant::INT) {
-            const godot::real_t parsed_radius = radius_variant;
-            return godot::Math::max(parsed_radius, godot::real_t(0.0));
+        godot::real_t max_radius = godot::real_t(0.0);
+        for (const float radius : *shockwave_data) {
+            max_radius = godot::Math::max(max_radius, static_cast<godot::real_t>(radius));
         }
-
-        return godot::real_t(0.0);
+        return max_radius;
     }
 
 } // namespace enemy_take_damage
@@ -82,7 +52,8 @@ inline FlecsRegistry register_enemy_take_damage_system([](flecs::world& world) {
         const EnemyAnimationSettings* animation_settings = stage_world.try_get<EnemyAnimationSettings>();
         const ShockwaveData* shockwave_data = stage_world.try_get<ShockwaveData>();
         const PlayerPosition* player_position = stage_world.try_get<PlayerPosition>();
-        if (take_damage_settings == nullptr) {
+        GodotEventQueue* event_queue = stage_world.try_get_mut<GodotEventQueue>();
+        if (take_damage_settings == nullptr || event_queue == nullptr) {
             return;
         }
 
@@ -101,8 +72,8 @@ inline FlecsRegistry register_enemy_take_damage_system([](flecs::world& world) {
             }
         }
 
-        const godot::Array projectile_positions = enemy_take_damage::get_projectile_positions(projectile_data);
-        const std::int32_t projectile_count = static_cast<std::int32_t>(projectile_positions.size());
+        const godot::Vector2* projectile_positions = projectile_data != nullptr ? projectile_data->values : nullptr;
+        const std::int32_t projectile_count = projectile_data != nullptr ? static_cast<std::int32_t>(projectile_data->count) : 0;
         const bool has_projectiles = projectile_count > 0;
         const bool can_process_projectiles = has_projectiles && movement_settings != nullptr;
 
@@ -146,6 +117,7 @@ inline FlecsRegistry register_enemy_take_damage_system([](flecs::world& world) {
             return;
         }
 
+        GodotEventBatch& damage_events = event_queue->get_batch("enemy_took_damage");
         std::vector<godot::real_t> accumulated_damage(static_cast<std::size_t>(enemy_count), godot::real_t(0.0));
 
         if (can_process_projectiles) {
@@ -167,12 +139,7 @@ inline FlecsRegistry register_enemy_take_damage_system([](flecs::world& world) {
                 spatial_hash);
 
             for (std::int32_t projectile_index = 0; projectile_index < projectile_count; ++projectile_index) {
-                const godot::Variant projectile_variant = projectile_positions[projectile_index];
-                if (projectile_variant.get_type() != godot::Variant::VECTOR2) {
-                    continue;
-                }
-
-                const godot::Vector2 projectile_position = projectile_variant;
+                const godot::Vector2 projectile_position = projectile_positions[projectile_index];
                 const enemy_spatial_hash::GridCellKey projectile_cell = enemy_spatial_hash::make_key(projectile_position, clamped_cell_size);
 
                 for (std::int32_t offset_x = -cell_span; offset_x <= cell_span; ++offset_x) {
@@ -245,12 +212,8 @@ inline FlecsRegistry register_enemy_take_damage_system([](flecs::world& world) {
                 reaction_timer.value = godot::Math::max(reaction_timer.value, hit_reaction_duration);
             }
 
-            flecs::entity damaged_entity = targets[target_index].entity;
-            const flecs::entity prefab_entity = damaged_entity.target(flecs::IsA);
-            godot::Dictionary signal_data;
-            signal_data["enemy_type"] = godot::String(prefab_entity.name().c_str());
-            signal_data["enemy_position"] = targets[target_index].position->value;
-            emit_godot_signal(stage_world, damaged_entity, "enemy_took_damage", signal_data);
+            const flecs::entity prefab_entity = targets[target_index].entity.target(flecs::IsA);
+            damage_events.push(targets[target_index].position->value, event_queue->get_prefab_index(prefab_entity), static_cast<float>(total_damage));
         }
     });
 });
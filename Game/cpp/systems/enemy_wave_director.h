@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <godot_cpp/core/math_defs.hpp>
+#include <godot_cpp/variant/vector2.hpp>
+
+#include "src/flecs_registry.h"
+#include "src/utilities/prefab_batch_spawn.h"
+
+#include "components/singletons.h"
+
+namespace enemy_wave_director {
+
+    // splitmix64, on the schedule's own state so that a seeded schedule spawns the same waves in a replay
+    inline float next_unit_float(std::uint64_t& state) {
+        state += 0x9E3779B97F4A7C15ULL;
+        std::uint64_t value = state;
+        value = (value ^ (value >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+        value = (value ^ (value >> 27U)) * 0x94D049BB133111EBULL;
+        value ^= value >> 31U;
+        return static_cast<float>(value >> 40U) / 16777216.0f; // [0, 1)
+    }
+
+    // Linear interpolation between evenly spaced samples over x in [0, 1], like Curve::sample_baked(). Samples are `stride`
+    // floats apart, starting at `channel`.
+    inline float sample_baked(const std::vector<float>& samples, std::size_t stride, std::size_t channel, float x) {
+        const std::size_t sample_count = samples.size() / stride;
+        if (sample_count == 0) { return 0.0f; }
+        if (sample_count == 1) { return samples[channel]; }
+
+        const float position = std::clamp(x, 0.0f, 1.0f) * static_cast<float>(sample_count - 1);
+        const std::size_t lower = std::min(static_cast<std::size_t>(position), sample_count - 2);
+        const float weight = position - static_cast<float>(lower);
+        const float from = samples[lower * stride + channel];
+        const float to = samples[(lower + 1) * stride + channel];
+        return from + (to - from) * weight;
+    }
+
+    // Index into schedule.prefabs, drawn by the type weights at x
+    inline std::size_t pick_prefab(const SpawnSchedule& schedule, float x, float unit_value) {
+        const std::size_t prefab_count = schedule.prefabs.size();
+        if (schedule.type_weight_samples.size() < prefab_count) { return 0; }
+
+        float total_weight = 0.0f;
+        for (std::size_t prefab_idx = 0; prefab_idx < prefab_count; ++prefab_idx) {
+            total_weight += std::max(sample_baked(schedule.type_weight_samples, prefab_count, prefab_idx, x), 0.0f);
+        }
+
+        float pick = unit_value * total_weight;
+        for (std::size_t prefab_idx = 0; prefab_idx + 1 < prefab_count; ++prefab_idx) {
+            pick -= std::max(sample_baked(schedule.type_weight_samples, prefab_count, prefab_idx, x), 0.0f);
+            if (pick < 0.0f) { return prefab_idx; }
+        }
+        return prefab_count - 1;
+    }
+
+    // A point just outside one of the terrain's edges, uniformly along the spawnable length of the perimeter
+    inline godot::Vector2 pick_perimeter_position(const SpawnSchedule& schedule, float unit_value) {
+        const godot::Vector2& half_size = schedule.half_extents;
+        const godot::real_t margin = schedule.side_margin;
+        const godot::real_t spawnable_width = std::max(half_size.x * 2.0f - schedule.corner_exclusion * 2.0f, 0.0f);
+        const godot::real_t spawnable_height = std::max(half_size.y * 2.0f - schedule.corner_exclusion * 2.0f, 0.0f);
+
+        const godot::real_t total_perimeter = 2.0f * spawnable_width + 2.0f * spawnable_height;
+        if (total_perimeter == 0.0f) { return godot::Vector2(0.0f, 0.0f); }
+
+        godot::real_t pick = unit_value * total_perimeter;
+        if (pick < spawnable_width) { // Top edge
+            return godot::Vector2(pick - spawnable_width / 2.0f, -half_size.y - margin);
+        }
+        pick -= spawnable_width;
+
+        if (pick < spawnable_width) { // Bottom edge
+            return godot::Vector2(pick - spawnable_width / 2.0f, half_size.y + margin);
+        }
+        pick -= spawnable_width;
+
+        if (pick < spawnable_height) { // Left edge
+            return godot::Vector2(-half_size.x - margin, pick - spawnable_height / 2.0f);
+        }
+        pick -= spawnable_height;
+
+        return godot::Vector2(half_size.x + margin, pick - spawnable_height / 2.0f); // Right edge
+    }
+
+} // namespace enemy_wave_director
+
+// Spawns the enemies of the SpawnSchedule. Picks this frame's spawns first, grouped by prefab, then creates each prefab's in
+// one bulk call. Immediate, so the world isn't in readonly mode and the entities can be created right away.
+inline FlecsRegistry register_enemy_wave_director_system([](flecs::world& world) {
+    world.system<>("Enemy Wave Director")
+        .kind(flecs::OnUpdate)
+        .immediate()
+        .run([](flecs::iter& it) {
+        flecs::world stage_world = it.world();
+        SpawnSchedule* schedule = stage_world.try_get_mut<SpawnSchedule>();
+        SpawnDirectorState* state = stage_world.try_get_mut<SpawnDirectorState>();
+        if (schedule == nullptr || state == nullptr || schedule->prefabs.empty() || schedule->spawn_rate_samples.empty()) { return; }
+
+        state->elapsed += it.delta_time();
+        const float curve_x = std::clamp(static_cast<float>(state->elapsed * schedule->curve_time_scale), 0.0f, 1.0f);
+        state->spawn_debt += enemy_wave_director::sample_baked(schedule->spawn_rate_samples, 1, 0, curve_x) * it.delta_time();
+
+        // Don't save up spawns while the cap is reached, they'd all arrive at once when enemies die
+        const EnemyCount* enemy_count = stage_world.try_get<EnemyCount>();
+        const int64_t room = std::max<int64_t>(schedule->max_enemy_count - static_cast<int64_t>(enemy_count ? enemy_count->value : 0), 0);
+        state->spawn_debt = std::min(state->spawn_debt, static_cast<double>(room));
+
+        int64_t spawn_count = static_cast<int64_t>(std::floor(state->spawn_debt));
+        if (schedule->max_spawns_per_frame > 0) {
+            spawn_count = std::min(spawn_count, schedule->max_spawns_per_frame);
+        }
+        if (spawn_count <= 0) { return; }
+        state->spawn_debt -= static_cast<double>(spawn_count);
+
+        std::vector<std::vector<godot::Vector2>>& positions_by_prefab = schedule->positions_by_prefab;
+        positions_by_prefab.resize(schedule->prefabs.size());
+        for (int64_t spawn_idx = 0; spawn_idx < spawn_count; ++spawn_idx) {
+            const std::size_t prefab_idx = enemy_wave_director::pick_prefab(*schedule, curve_x, enemy_wave_director::next_unit_float(state->random_state));
+            positions_by_prefab[prefab_idx].push_back(
+                enemy_wave_director::pick_perimeter_position(*schedule, enemy_wave_director::next_unit_float(state->random_state)));
+        }
+
+        for (std::size_t prefab_idx = 0; prefab_idx < positions_by_prefab.size(); ++prefab_idx) {
+            std::vector<godot::Vector2>& positions = positions_by_prefab[prefab_idx];
+            spawn_prefab_batch_2d(stage_world, schedule->prefabs[prefab_idx], positions.data(), nullptr, nullptr, static_cast<int32_t>(positions.size()));
+            positions.clear();
+        }
+    });
+});
@@ -14,6 +14,7 @@ inline FlecsRegistry register_enemy_timer_tick_system([](flecs::world& world) {
     world.system<ProjectileHitTimeout, ShockwaveHitTimeout, DeathTimer, HitReactionTimer, HFlipTimer, VFlipTimer>("Enemy Timer Tick")
         .with(flecs::IsA, world.lookup("Enemy"))
         .kind(flecs::PreUpdate)
+        .multi_threaded() // Destruction is deferred to the worker's stage and merged at the end of the phase
         .run([](flecs::iter& it) {
         const EnemyTakeDamageSettings* take_damage_settings = it.world().try_get<EnemyTakeDamageSettings>();
         const godot::real_t projectile_cooldown = take_damage_settings != nullptr ? godot::Math::max(take_damage_settings->projectile_hit_cooldown, godot::real_t(0.0)) : godot::real_t(0.0);
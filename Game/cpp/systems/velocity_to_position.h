@@ -10,6 +10,7 @@ inline FlecsRegistry register_velocity_to_position_system([](flecs::world& world
         Position2D,
         const Velocity2D>("Velocity to Position")
         .kind(flecs::PostUpdate)
+        .multi_threaded()
         .each([](flecs::iter& it, size_t i, Position2D& position, const Velocity2D& velocity) {
         position.value += velocity.value * it.delta_time();
     });
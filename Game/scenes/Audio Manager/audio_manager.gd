@@ -29,21 +29,40 @@ func connect_to_flecs_signal():
 	if world == null:
 		push_warning("AudioManager: connect_to_flecs_signal called but the world instance is null")
 		return
-	world.flecs_signal_emitted.connect(_on_flecs_signal)
-
-
-func _on_flecs_signal(signal_name: StringName, data: Dictionary) -> void:
-	match signal_name:
-		"enemy_died":
-			match data.enemy_type:
-				"BugSmall": await _delay(); bug_small_die.play()
-				"BugHumanoid": await _delay(); bug_humanoid_die.play()
-				"BugLarge": await _delay(); bug_large_die.play()
-		"enemy_took_damage":
-			match data.enemy_type:
-				"BugSmall": bug_small_hurt.play()
-				"BugHumanoid": bug_humanoid_hurt.play()
-				"BugLarge": bug_large_hurt.play()
+	world.subscribe_events("enemy_died", _on_enemies_died)
+	world.subscribe_events("enemy_took_damage", _on_enemies_took_damage)
+
+
+# Events arrive batched per frame. Replaying a player restarts its sound, so each enemy type plays once per batch.
+func _on_enemies_died(_positions: PackedVector2Array, prefab_indices: PackedInt32Array, _amounts: PackedFloat32Array) -> void:
+	for enemy_type in _get_enemy_types(prefab_indices):
+		match enemy_type:
+			"BugSmall": _play_delayed(bug_small_die)
+			"BugHumanoid": _play_delayed(bug_humanoid_die)
+			"BugLarge": _play_delayed(bug_large_die)
+
+
+func _on_enemies_took_damage(_positions: PackedVector2Array, prefab_indices: PackedInt32Array, _amounts: PackedFloat32Array) -> void:
+	for enemy_type in _get_enemy_types(prefab_indices):
+		match enemy_type:
+			"BugSmall": bug_small_hurt.play()
+			"BugHumanoid": bug_humanoid_hurt.play()
+			"BugLarge": bug_large_hurt.play()
+
+
+func _get_enemy_types(prefab_indices: PackedInt32Array) -> PackedStringArray:
+	var prefab_names: PackedStringArray = world.get_event_prefab_names()
+	var enemy_types := PackedStringArray()
+	for prefab_index in prefab_indices:
+		var enemy_type: String = prefab_names[prefab_index]
+		if not enemy_types.has(enemy_type):
+			enemy_types.append(enemy_type)
+	return enemy_types
+
+
+func _play_delayed(player: AudioStreamPlayer) -> void:
+	await _delay()
+	player.play()
 
 
 func _delay(delay: float = 0.5):
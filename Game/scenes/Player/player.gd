@@ -99,6 +99,7 @@ signal gem_collected(value: int)
 @onready var _sprite: Sprite2D = $CharacterBody2D/Sprite2D
 @onready var health_bar: ProgressBar = $CharacterBody2D/HealthBar
 @onready var damage_cooldown_timer: Timer = $DamageCooldownTimer
+@onready var player_position_handle: int = world.get_singleton_handle("PlayerPosition")
 
 func _ready() -> void:
 	animation_frame_changed.connect(_on_animation_frame_changed)
@@ -110,7 +111,7 @@ func _ready() -> void:
 	health_bar.value = health_bar.max_value
 	health_bar_original_modulation = health_bar.modulate
 	
-	world.flecs_signal_emitted.connect(_on_flecs_signal)
+	world.subscribe_events("enemy_hit_player", _on_enemy_hit_player)
 	
 		
 func _process(delta: float) -> void:
@@ -183,7 +184,7 @@ func _handle_input(delta: float) -> void:
 	character_body.velocity = character_body.velocity.lerp(target_velocity, 1 - exp(-delta * acceleration_smoothing))
 
 	is_colliding = character_body.move_and_slide()
-	world.set_singleton_component("PlayerPosition", character_body.global_position)
+	world.set_singleton_by_handle(player_position_handle, character_body.global_position)
 
 	movement_in_frame = character_body.global_position - position_at_frame_start
 	has_moved_this_frame = movement_in_frame.length() > 0.01
@@ -248,23 +249,23 @@ func _on_health_bar_value_changed(value: float) -> void:
 	fill_style.bg_color = health_bar_empty_colour.lerp(health_bar_full_colour, health_bar.value / health_bar.max_value)
 
 
-func _on_flecs_signal(signal_name: StringName, data: Dictionary) -> void:
+func _on_enemy_hit_player(_positions: PackedVector2Array, _prefab_indices: PackedInt32Array, damage_amounts: PackedFloat32Array) -> void:
 	if is_dead: return
-	if signal_name == "enemy_hit_player":
-		if (damage_cooldown_timer.time_left > 0): return
-		
-		player_took_damage.emit()
-		AudioManager.player_hurt.play()
-		
-		health -= data.damage_amount
-		health_bar.value = max(health / max_health, 0)
-		health_bar.modulate = Color.WHITE
-		
-		if health > 0:
-			damage_cooldown_timer.start()
-		else:
-			await _handle_death()
-			health_bar.visible = false
+	if damage_amounts.is_empty(): return
+	if (damage_cooldown_timer.time_left > 0): return
+	
+	player_took_damage.emit()
+	AudioManager.player_hurt.play()
+	
+	health -= damage_amounts[0] # Only one hit can land per damage cooldown
+	health_bar.value = max(health / max_health, 0)
+	health_bar.modulate = Color.WHITE
+	
+	if health > 0:
+		damage_cooldown_timer.start()
+	else:
+		await _handle_death()
+		health_bar.visible = false
 
 
 func _handle_death() -> void:
@@ -0,0 +1,573 @@
+// Headless benchmark of the game's ECS systems.
+//
+// Registers the components, prefabs and systems of Game/cpp into a plain flecs::world (no Godot binary or engine
+// singletons involved), loads the enemy prefab scripts from disk, spawns a BugSmall/BugHumanoid/BugLarge population
+// and drives PlayerPosition, ProjectileData and ShockwaveData from a fixed script. Per-system and total frame times
+// are written to stdout as CSV, one block per enemy count. Two extra rows compare Y draw-order sorting with an order_by
+// query against the DrawOrderSorter used by the renderer, and two more compare packing interpolated MultiMesh rows for all
+// enemies on one thread and on --pack-threads threads (default: all hardware threads), also outside of the frame. A table of
+// static transformed entities checks that "Transform2D Update" skips tables nothing wrote to.
+//
+// Build: scons benchmark
+// Run:   ./benchmarks/bin/ecs_benchmark [--counts 1000,10000,100000] [--frames 600] [--warmup 60] [--threads 1]
+//                                       [--scripts Game/resources] [--density 0.0006] [--seed 1] [--pack-threads 0]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <godot_cpp/variant/vector2.hpp>
+
+#include <flecs.h>
+
+#include "src/flecs_registry.h"
+#include "src/components/entity_rendering.h"
+#include "src/components/godot_variants.h"
+#include "src/components/player.h"
+#include "src/components/transform.h"
+#include "src/systems/transform_update.h"
+#include "src/utilities/draw_order_sort.h"
+#include "src/utilities/godot_event_queue.h"
+#include "src/utilities/multimesh_packing.h"
+#include "src/utilities/parallel_for.h"
+#include "src/utilities/system_timings.h"
+
+#include "components/singletons.h"
+
+namespace
+{
+    struct BenchmarkOptions
+    {
+        std::vector<int> enemy_counts = { 1000, 2000, 5000, 10000, 20000, 50000, 100000 };
+        int frames = 600;
+        int warmup_frames = 60;
+        int threads = 1;
+        int pack_threads = 0; // 0: std::thread::hardware_concurrency()
+        std::string scripts_root = "Game/resources";
+        double density = 0.0006; // Enemies per square pixel of the arena, so neighbourhood sizes stay comparable across counts
+        unsigned int seed = 1;
+        float delta = 1.0f / 60.0f;
+    };
+
+    // Same ratio as the initial population spawned by stage.gd
+    struct EnemyTypeWeight
+    {
+        const char* prefab_name;
+        int weight;
+    };
+    constexpr EnemyTypeWeight ENEMY_TYPE_WEIGHTS[] = { { "BugSmall", 17 }, { "BugHumanoid", 2 }, { "BugLarge", 1 } };
+
+    constexpr int PROJECTILE_COUNT = 48;
+    constexpr float PROJECTILE_SPEED = 400.0f;
+    constexpr float PROJECTILE_RANGE = 600.0f;
+    constexpr float SHOCKWAVE_INTERVAL_SEC = 2.0f;
+    constexpr float SHOCKWAVE_DURATION_SEC = 0.5f;
+    constexpr float SHOCKWAVE_MAX_RADIUS = 160.0f;
+
+    std::vector<int> parse_counts(const std::string& text)
+    {
+        std::vector<int> counts;
+        std::stringstream stream(text);
+        std::string item;
+        while (std::getline(stream, item, ','))
+        {
+            if (!item.empty())
+            {
+                counts.push_back(std::max(std::atoi(item.c_str()), 0));
+            }
+        }
+        return counts;
+    }
+
+    bool parse_options(int argc, char** argv, BenchmarkOptions& options)
+    {
+        for (int arg_idx = 1; arg_idx < argc; ++arg_idx)
+        {
+            const std::string arg = argv[arg_idx];
+            const bool has_value = arg_idx + 1 < argc;
+            if (arg == "--counts" && has_value) { options.enemy_counts = parse_counts(argv[++arg_idx]); }
+            else if (arg == "--frames" && has_value) { options.frames = std::max(std::atoi(argv[++arg_idx]), 1); }
+            else if (arg == "--warmup" && has_value) { options.warmup_frames = std::max(std::atoi(argv[++arg_idx]), 0); }
+            else if (arg == "--threads" && has_value) { options.threads = std::max(std::atoi(argv[++arg_idx]), 1); }
+            else if (arg == "--scripts" && has_value) { options.scripts_root = argv[++arg_idx]; }
+            else if (arg == "--density" && has_value) { options.density = std::max(std::atof(argv[++arg_idx]), 1e-6); }
+            else if (arg == "--pack-threads" && has_value) { options.pack_threads = std::max(std::atoi(argv[++arg_idx]), 0); }
+            else if (arg == "--seed" && has_value) { options.seed = static_cast<unsigned int>(std::strtoul(argv[++arg_idx], nullptr, 10)); }
+            else
+            {
+                std::cerr << "Unknown or incomplete argument: " << arg << "\n"
+                          << "Usage: ecs_benchmark [--counts 1000,10000] [--frames N] [--warmup N] [--threads N]"
+                          << " [--scripts DIR] [--density D] [--seed S] [--pack-threads N]\n";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Filesystem counterpart of FlecsScriptsLoader: runs every *.flecs file below root, shallower directories first.
+    bool load_scripts(flecs::world& world, const std::string& root)
+    {
+        namespace fs = std::filesystem;
+
+        std::error_code error;
+        if (!fs::is_directory(root, error))
+        {
+            std::cerr << "Flecs scripts path does not exist: " << root << "\n";
+            return false;
+        }
+
+        std::vector<std::string> script_paths;
+        for (const fs::directory_entry& entry : fs::recursive_directory_iterator(root, error))
+        {
+            if (entry.is_regular_file() && entry.path().extension() == ".flecs")
+            {
+                script_paths.push_back(entry.path().generic_string());
+            }
+        }
+
+        std::sort(script_paths.begin(), script_paths.end(), [](const std::string& a, const std::string& b) {
+            const auto depth_a = std::count(a.begin(), a.end(), '/');
+            const auto depth_b = std::count(b.begin(), b.end(), '/');
+            if (depth_a != depth_b) { return depth_a < depth_b; }
+            return a < b;
+        });
+
+        for (const std::string& path : script_paths)
+        {
+            std::ifstream file(path, std::ios::binary);
+            std::string script((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            script.erase(std::remove(script.begin(), script.end(), '\r'), script.end());
+            if (script.empty() || world.script_run(path.c_str(), script.c_str()) != 0)
+            {
+                std::cerr << "Error running flecs script: " << path << "\n";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    class EnemySpawner
+    {
+    public:
+        EnemySpawner(flecs::world& world, float arena_half_extent, unsigned int seed) : world(world), arena_half_extent(arena_half_extent), rng(seed)
+        {
+            for (const EnemyTypeWeight& type_weight : ENEMY_TYPE_WEIGHTS)
+            {
+                prefabs.push_back(world.lookup(type_weight.prefab_name));
+                total_weight += type_weight.weight;
+            }
+        }
+
+        bool is_valid() const
+        {
+            return std::all_of(prefabs.begin(), prefabs.end(), [](flecs::entity prefab) { return prefab.is_valid(); });
+        }
+
+        void spawn(int count)
+        {
+            std::uniform_int_distribution<int> weight_distribution(0, total_weight - 1);
+            std::uniform_real_distribution<float> position_distribution(-arena_half_extent, arena_half_extent);
+
+            for (int spawn_idx = 0; spawn_idx < count; ++spawn_idx)
+            {
+                int pick = weight_distribution(rng);
+                std::size_t prefab_idx = 0;
+                while (pick >= ENEMY_TYPE_WEIGHTS[prefab_idx].weight)
+                {
+                    pick -= ENEMY_TYPE_WEIGHTS[prefab_idx].weight;
+                    ++prefab_idx;
+                }
+
+                // Enemies are TranslationOnly2D, so there's no Transform2D to set
+                const godot::Vector2 position(position_distribution(rng), position_distribution(rng));
+                world.entity().is_a(prefabs[prefab_idx])
+                    .set<Position2D>({ position })
+                    .set<PreviousPosition2D>({ position });
+            }
+        }
+
+    private:
+        flecs::world& world;
+        float arena_half_extent;
+        std::mt19937 rng;
+        std::vector<flecs::entity> prefabs;
+        int total_weight = 0;
+    };
+
+    // Stands in for the GDScript side: the player circles the arena centre while firing projectiles outwards,
+    // and a shockwave goes off at a fixed interval.
+    class ScriptedPlayer
+    {
+    public:
+        explicit ScriptedPlayer(float arena_half_extent) : orbit_radius(arena_half_extent * 0.25f),
+            projectiles(std::make_shared<std::vector<godot::Vector2>>(PROJECTILE_COUNT)),
+            shockwaves(std::make_shared<std::vector<float>>(1, 0.0f))
+        {
+        }
+
+        void update(flecs::world& world, float time)
+        {
+            const godot::Vector2 player_position(std::cos(time * 0.5f) * orbit_radius, std::sin(time * 0.5f) * orbit_radius);
+            world.set<PlayerPosition>({ player_position });
+
+            for (int projectile_idx = 0; projectile_idx < PROJECTILE_COUNT; ++projectile_idx)
+            {
+                const float angle = static_cast<float>(projectile_idx) * (6.2831853f / PROJECTILE_COUNT);
+                const float distance = std::fmod(time * PROJECTILE_SPEED + projectile_idx * 37.0f, PROJECTILE_RANGE);
+                (*projectiles)[projectile_idx] = player_position + godot::Vector2(std::cos(angle), std::sin(angle)) * distance;
+            }
+            ProjectileData projectile_data;
+            projectile_data.storage = projectiles;
+            projectile_data.values = projectiles->data();
+            projectile_data.count = static_cast<int64_t>(projectiles->size());
+            world.set<ProjectileData>(projectile_data);
+
+            const float shockwave_time = std::fmod(time, SHOCKWAVE_INTERVAL_SEC);
+            (*shockwaves)[0] = shockwave_time < SHOCKWAVE_DURATION_SEC ? SHOCKWAVE_MAX_RADIUS * shockwave_time / SHOCKWAVE_DURATION_SEC : 0.0f;
+            ShockwaveData shockwave_data;
+            shockwave_data.storage = shockwaves;
+            shockwave_data.values = shockwaves->data();
+            shockwave_data.count = static_cast<int64_t>(shockwaves->size());
+            world.set<ShockwaveData>(shockwave_data);
+        }
+
+    private:
+        float orbit_radius;
+        std::shared_ptr<std::vector<godot::Vector2>> projectiles;
+        std::shared_ptr<std::vector<float>> shockwaves;
+    };
+
+    double percentile(std::vector<double> samples, double fraction)
+    {
+        if (samples.empty()) { return 0.0; }
+        std::sort(samples.begin(), samples.end());
+        const std::size_t index = std::min(static_cast<std::size_t>(fraction * static_cast<double>(samples.size())), samples.size() - 1);
+        return samples[index];
+    }
+
+    void print_row(int enemy_count, int threads, const char* name, const std::vector<double>& samples)
+    {
+        double sum = 0.0;
+        for (double sample : samples) { sum += sample; }
+        std::printf("%d,%d,\"%s\",%.3f,%.3f,%.3f,%.3f\n", enemy_count, threads, name,
+            percentile(samples, 0.0), samples.empty() ? 0.0 : sum / static_cast<double>(samples.size()),
+            percentile(samples, 0.99), percentile(samples, 1.0));
+    }
+
+    // Y draw order of all positions, the way the renderer used to get it (order_by on the query) and the way it gets it
+    // now (collect keys in table order, then sort an index permutation that is reused across frames).
+    class DrawOrderComparison
+    {
+    public:
+        explicit DrawOrderComparison(flecs::world& world) :
+            ordered_query(world.query_builder<const Position2D>()
+                .cached()
+                .order_by<Position2D>([](flecs::entity_t, const Position2D* p1, flecs::entity_t, const Position2D* p2) {
+                    return (p1->value.y > p2->value.y) - (p1->value.y < p2->value.y);
+                })
+                .build()),
+            unordered_query(world.query_builder<const Position2D>().cached().build())
+        {
+        }
+
+        void sample_frame()
+        {
+            sorted_keys.clear();
+            const auto order_by_start = std::chrono::steady_clock::now();
+            ordered_query.each([this](const Position2D& position) { sorted_keys.push_back(position.value.y); });
+            const auto order_by_end = std::chrono::steady_clock::now();
+
+            keys.clear();
+            const auto sorter_start = std::chrono::steady_clock::now();
+            unordered_query.run([this](flecs::iter& it) {
+                while (it.next())
+                {
+                    const flecs::field<const Position2D> positions = it.field<const Position2D>(0);
+                    for (const auto i : it) { keys.push_back(positions[i].value.y); }
+                }
+            });
+            sorter.sort(keys.data(), keys.size());
+            const auto sorter_end = std::chrono::steady_clock::now();
+
+            order_by_usec.push_back(std::chrono::duration<double, std::micro>(order_by_end - order_by_start).count());
+            sorter_usec.push_back(std::chrono::duration<double, std::micro>(sorter_end - sorter_start).count());
+        }
+
+        void print(int enemy_count, int threads) const
+        {
+            print_row(enemy_count, threads, "Draw order (order_by query)", order_by_usec);
+            print_row(enemy_count, threads, "Draw order (DrawOrderSorter)", sorter_usec);
+        }
+
+    private:
+        flecs::query<const Position2D> ordered_query;
+        flecs::query<const Position2D> unordered_query;
+        utilities::DrawOrderSorter sorter;
+        std::vector<float> keys;
+        std::vector<float> sorted_keys;
+        std::vector<double> order_by_usec;
+        std::vector<double> sorter_usec;
+    };
+
+    // Packs every translation-only enemy into interpolated 2D MultiMesh rows the way the renderer does, once with all spans on
+    // the calling thread and once split over a ParallelFor, and checks that both produce the same buffer.
+    class PackingComparison
+    {
+    public:
+        PackingComparison(flecs::world& world, unsigned int thread_count) :
+            query(world.query_builder()
+                .with<const Position2D>()
+                .with<const PreviousPosition2D>().optional()
+                .with<TranslationOnly2D>()
+                .cached()
+                .build()),
+            kernel(utilities::select_multimesh_pack_kernel(false, false, false)),
+            workers(thread_count),
+            parallel_name("MultiMesh packing (" + std::to_string(thread_count) + " threads)")
+        {
+        }
+
+        void sample_frame()
+        {
+            const auto serial_start = std::chrono::steady_clock::now();
+            collect_spans();
+            utilities::pack_spans(kernel, spans, row_count, make_target(serial_rows), nullptr);
+            const auto serial_end = std::chrono::steady_clock::now();
+
+            const auto parallel_start = std::chrono::steady_clock::now();
+            collect_spans();
+            utilities::pack_spans(kernel, spans, row_count, make_target(parallel_rows), &workers);
+            const auto parallel_end = std::chrono::steady_clock::now();
+
+            if (serial_rows != parallel_rows)
+            {
+                mismatched_frames++;
+            }
+            serial_usec.push_back(std::chrono::duration<double, std::micro>(serial_end - serial_start).count());
+            parallel_usec.push_back(std::chrono::duration<double, std::micro>(parallel_end - parallel_start).count());
+        }
+
+        void print(int enemy_count, int threads) const
+        {
+            print_row(enemy_count, threads, "MultiMesh packing (1 thread)", serial_usec);
+            print_row(enemy_count, threads, parallel_name.c_str(), parallel_usec);
+            if (mismatched_frames > 0)
+            {
+                std::cerr << "Parallel packing differed from serial packing in " << mismatched_frames << " frames.\n";
+            }
+        }
+
+    private:
+        static constexpr std::size_t FLOATS_PER_INSTANCE = 8;
+        static constexpr float INTERPOLATION_ALPHA = 0.5f;
+
+        flecs::query<> query;
+        utilities::MultiMeshPackKernel kernel;
+        utilities::ParallelFor workers;
+        std::string parallel_name;
+        std::vector<utilities::MultiMeshPackSpan> spans;
+        std::size_t row_count = 0;
+        std::vector<float> serial_rows;
+        std::vector<float> parallel_rows;
+        std::vector<double> serial_usec;
+        std::vector<double> parallel_usec;
+        int mismatched_frames = 0;
+
+        void collect_spans()
+        {
+            spans.clear();
+            row_count = 0;
+            query.run([this](flecs::iter& it) {
+                while (it.next())
+                {
+                    spans.push_back(utilities::make_pack_span<Position2D>(it, true, false, false,
+                        static_cast<uint32_t>(row_count), static_cast<uint32_t>(it.count())));
+                    row_count += it.count();
+                }
+            });
+        }
+
+        utilities::MultiMeshPackTarget make_target(std::vector<float>& rows)
+        {
+            rows.resize(row_count * FLOATS_PER_INSTANCE);
+            utilities::MultiMeshPackTarget target{};
+            target.rows = rows.data();
+            target.interpolation_alpha = INTERPOLATION_ALPHA;
+            return target;
+        }
+    };
+
+    // A table of transformed entities nothing writes to after they're spawned. A transform written behind the back of change
+    // detection must survive every frame, which it only does when "Transform2D Update" skips the table.
+    class UntouchedTableCheck
+    {
+    public:
+        explicit UntouchedTableCheck(flecs::world& world)
+        {
+            for (int entity_idx = 0; entity_idx < ENTITY_COUNT; ++entity_idx)
+            {
+                const godot::Vector2 position(static_cast<float>(entity_idx), 0.0f);
+                entities.push_back(world.entity()
+                    .set<Position2D>({ position })
+                    .set<Rotation2D>({ 0.0f })
+                    .set<Scale2D>({ godot::Vector2(1.0f, 1.0f) })
+                    .set<godot::Transform2D>(godot::Transform2D(0.0f, position)));
+            }
+        }
+
+        // Call between frames, once a frame has processed the spawn. Frames before it aren't checked.
+        void plant_marker()
+        {
+            *entities.front().try_get_mut<godot::Transform2D>() = MARKER;
+            marker_planted = true;
+        }
+
+        void sample_frame()
+        {
+            if (marker_planted && *entities.front().try_get<godot::Transform2D>() != MARKER)
+            {
+                recomposed_frames++;
+                plant_marker();
+            }
+        }
+
+        void print() const
+        {
+            if (recomposed_frames > 0)
+            {
+                std::cerr << "\"Transform2D Update\" recomposed an untouched table in " << recomposed_frames << " frames.\n";
+            }
+        }
+
+    private:
+        static constexpr int ENTITY_COUNT = 256;
+        inline static const godot::Transform2D MARKER = godot::Transform2D(0.0f, godot::Vector2(-1.0f, -1.0f));
+
+        std::vector<flecs::entity> entities;
+        bool marker_planted = false;
+        int recomposed_frames = 0;
+    };
+
+    bool run_benchmark(const BenchmarkOptions& options, int enemy_count)
+    {
+        flecs::world world;
+        register_components_and_systems_with_world(world);
+        if (!load_scripts(world, options.scripts_root))
+        {
+            return false;
+        }
+        if (options.threads > 1)
+        {
+            world.set_threads(options.threads);
+        }
+        world.set<RenderInterpolation>({ false, 1.0f });
+
+        const float arena_half_extent = 0.5f * static_cast<float>(std::sqrt(static_cast<double>(std::max(enemy_count, 1)) / options.density));
+        EnemySpawner spawner(world, arena_half_extent, options.seed);
+        if (!spawner.is_valid())
+        {
+            std::cerr << "Enemy prefabs not found; check --scripts.\n";
+            return false;
+        }
+
+        ScriptedPlayer player(arena_half_extent);
+        spawner.spawn(enemy_count);
+        DrawOrderComparison draw_order(world);
+        const unsigned int pack_threads = options.pack_threads > 0
+            ? static_cast<unsigned int>(options.pack_threads)
+            : std::max(std::thread::hardware_concurrency(), 1U);
+        PackingComparison packing(world, pack_threads);
+        UntouchedTableCheck untouched_table(world);
+
+        utilities::SystemTimings system_timings(static_cast<std::size_t>(options.frames));
+        std::vector<double> frame_usec;
+        frame_usec.reserve(static_cast<std::size_t>(options.frames));
+
+        float time = 0.0f;
+        for (int frame_idx = 0; frame_idx < options.warmup_frames + options.frames; ++frame_idx)
+        {
+            if (frame_idx == options.warmup_frames)
+            {
+                system_timings.track_systems(world);
+            }
+            if (frame_idx == std::max(options.warmup_frames, 1))
+            {
+                untouched_table.plant_marker();
+            }
+
+            player.update(world, time);
+
+            const auto frame_start = std::chrono::steady_clock::now();
+            world.progress(options.delta);
+            const auto frame_end = std::chrono::steady_clock::now();
+            time += options.delta;
+
+            if (frame_idx >= options.warmup_frames)
+            {
+                frame_usec.push_back(std::chrono::duration<double, std::micro>(frame_end - frame_start).count());
+                system_timings.sample_frame(world);
+                draw_order.sample_frame();
+                packing.sample_frame();
+                untouched_table.sample_frame();
+            }
+
+            // Nothing flushes events to Godot here, so drop them like FlecsWorld does after delivering them
+            GodotEventQueue* event_queue = world.try_get_mut<GodotEventQueue>();
+            if (event_queue != nullptr)
+            {
+                for (GodotEventBatch& batch : event_queue->batches) { batch.clear(); }
+            }
+
+            // Keep the population at the requested size by replacing killed enemies outside of the measured frame
+            const EnemyCount* current_enemy_count = world.try_get<EnemyCount>();
+            if (current_enemy_count != nullptr && static_cast<int>(current_enemy_count->value) < enemy_count)
+            {
+                spawner.spawn(enemy_count - static_cast<int>(current_enemy_count->value));
+            }
+        }
+
+        for (const utilities::SystemTimingSummary& summary : system_timings.summarize())
+        {
+            std::printf("%d,%d,\"%s\",%.3f,%.3f,%.3f,%.3f\n", enemy_count, options.threads, summary.name.c_str(),
+                summary.min_usec, summary.mean_usec, summary.p99_usec, summary.max_usec);
+        }
+
+        print_row(enemy_count, options.threads, "Frame total", frame_usec);
+        draw_order.print(enemy_count, options.threads);
+        packing.print(enemy_count, options.threads);
+        untouched_table.print();
+        std::fflush(stdout);
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    BenchmarkOptions options;
+    if (!parse_options(argc, argv, options))
+    {
+        return 2;
+    }
+
+    std::printf("enemy_count,threads,system,min_usec,mean_usec,p99_usec,max_usec\n");
+    for (int enemy_count : options.enemy_counts)
+    {
+        if (!run_benchmark(options, enemy_count))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
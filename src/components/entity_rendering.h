@@ -1,30 +1,112 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <unordered_map>
+#include <utility>
 #include <string>
 #include <vector>
 #include <functional>
+#include <memory>
 
+#include <godot_cpp/variant/packed_float32_array.hpp>
+#include <godot_cpp/variant/rect2.hpp>
 #include <godot_cpp/variant/rid.hpp>
+#include <godot_cpp/variant/string.hpp>
+#include <godot_cpp/variant/transform2d.hpp>
+#include <godot_cpp/variant/transform3d.hpp>
+#include <godot_cpp/variant/vector2.hpp>
+#include <godot_cpp/variant/vector3.hpp>
 #include <godot_cpp/classes/multi_mesh.hpp>
+#include <godot_cpp/classes/ref.hpp>
 
 #include "src/flecs_registry.h"
+#include "src/utilities/draw_order_sort.h"
 #include "src/utilities/godot_hashes.h"
+#include "src/utilities/multimesh_pack_kernels.h"
+#include "src/utilities/parallel_for.h"
 
 
 enum class RendererType {
     MultiMesh,
 };
 
+// From the "draw_order" metadata of a renderer: "X", "Y", "Z" (3D only) sort by that origin axis, "camera" (3D only) sorts
+// back to front along the active Camera3D's view direction.
+enum class DrawOrder {
+    None,
+    X,
+    Y,
+    Z,
+    CameraDepth,
+};
+
+// A run of instances from one table that was packed into consecutive rows of a MultiMesh buffer
+struct RenderedTableRange
+{
+    const void* table;
+    int32_t offset;
+    int32_t count;
+
+    bool operator==(const RenderedTableRange& other) const
+    {
+        return table == other.table && offset == other.offset && count == other.count;
+    }
+};
+
+// Buffers per MultiMesh renderer. The threaded RenderingServer queues multimesh_set_buffer() with a reference to the array,
+// so writing into the buffer of the last frame or two would copy it first (copy-on-write). By the time the ring comes back
+// around, the server has released it.
+constexpr size_t MULTIMESH_BUFFER_RING_SIZE = 3;
+
 struct MultiMeshRenderer
 {
     godot::RID rid;
+    godot::Ref<godot::MultiMesh> multimesh; // Kept for growing the instance count
+    godot::String name; // Name of the renderer node, for stats
     std::vector<flecs::query<>> queries; // One MultiMeshInstance can render multiple prefab types. Store a list of queries (one per prefab) for each renderer.
     godot::MultiMesh::TransformFormat transform_format;
     bool use_colors;
     bool use_custom_data;
-    size_t instance_count;
+    size_t instance_count; // Capacity of the MultiMesh, grown when more instances match (see reserve_renderer_capacity)
     size_t visible_instance_count;
+    utilities::MultiMeshPackKernel pack_kernel = nullptr; // Specialised for the buffer layout when the renderer is set up
+
+    // From the "render_update" metadata: "static" renderers are never interpolated, so they are only repacked and uploaded
+    // when their queries report changes. "dynamic" (the default) renderers are also repacked on every interpolated frame.
+    bool is_static = false;
+    bool needs_upload = true; // Set when the buffer doesn't hold the exact current values (first frame, or interpolated values)
+    std::vector<RenderedTableRange> uploaded_ranges; // Buffer layout of the last upload, used to skip repacking unchanged tables
+
+    // From the "cull_margin" metadata (2D only): the renderer only packs instances tagged OnScreen, which the "Viewport Culling"
+    // system maintains from the CameraRect grown by cull_margin on every side.
+    bool cull = false;
+    float cull_margin = 0.0f;
+    // 2D only: the entities of `queries` with just their Transform2D, without the OnScreen filter or change detection.
+    // Used for culling and by FlecsWorld::sample_renderer_positions().
+    std::vector<flecs::query<>> instance_queries;
+    // Like queries and instance_queries, for the entities rendered from their transform components: TranslationOnly2D entities
+    // in 2D renderers (field 0 is the Position2D, field 1 the optional PreviousPosition2D) and ComposedTransform3D entities in 3D
+    // ones (fields 0 to 2 are Position3D, Rotation3D and Scale3D). Their rows follow the rows of `queries`.
+    std::vector<flecs::query<>> component_queries;
+    std::vector<flecs::query<>> component_instance_queries; // 2D only
+
+    // Sorted renderers pack rows unsorted into staging_rows with one key per row, then copy them into the buffer in key order
+    DrawOrder draw_order = DrawOrder::None;
+    std::vector<float> staging_rows;
+    std::vector<float> sort_keys;
+    utilities::DrawOrderSorter sorter;
+
+    // Allocated when the renderer is set up and only resized when instance_count changes. buffer_index is the last uploaded one.
+    std::array<godot::PackedFloat32Array, MULTIMESH_BUFFER_RING_SIZE> buffers;
+    size_t buffer_index = 0;
+    int64_t uploaded_bytes = 0;  // Passed to multimesh_set_buffer() in the last rendered frame, 0 when the upload was skipped
+    int64_t buffer_copies = 0;   // Times a ring buffer was still shared when written to and got copied; should stay at 0
+
+    // Per-update scratch, kept to avoid allocating every frame
+    std::vector<RenderedTableRange> previous_ranges;
+    std::vector<utilities::MultiMeshPackSpan> spans;
+    std::vector<std::pair<size_t, size_t>> reused_rows; // First row and row count of tables copied from the previous buffer
 };
 
 struct RenderingColor {
@@ -41,12 +123,52 @@ struct RenderingCustomData {
     float a;
 };
 
+// Transform at the end of the previous simulation tick. Captured at the start of every tick while render interpolation is enabled,
+// so the renderer can blend towards the current transform when the display rate is higher than the simulation rate.
+struct PreviousTransform2D {
+    godot::Transform2D value;
+};
+
+struct PreviousTransform3D {
+    godot::Transform3D value;
+};
+
+// The same for TranslationOnly2D entities, which are rendered from their Position2D
+struct PreviousPosition2D {
+    godot::Vector2 value;
+};
+
+// Written by FlecsWorld::progress(). alpha is the fraction of a simulation tick that has elapsed since the last tick completed.
+struct RenderInterpolation {
+    bool enabled;
+    float alpha;
+};
+
+// Written by FlecsWorld before rendering when a Camera3D is active, for renderers sorted by camera depth
+struct DrawOrderCamera {
+    godot::Vector3 position;
+    godot::Vector3 forward;
+};
+
+// Canvas area visible through the active Camera2D, written by FlecsWorld before rendering
+struct CameraRect {
+    godot::Rect2 rect;
+};
+
+// Toggled on entities of culled renderers by the "Viewport Culling" system: enabled while the entity is inside the camera rect
+// (plus the renderer's margin). Other systems can add .with<OnScreen>() to skip off-screen work; entities that were never on
+// screen don't have the tag at all.
+struct OnScreen {};
+
 struct EntityRenderers
 {
     // Map from renderer type to a map of prefab names to multimesh RIDs.
     // Key for the inner map is a string representation of the MultiMesh RID ID (we group all prefab queries for a single MultiMesh into one MultiMeshRenderer).
     // Use godot::RID as the inner map key so each MultiMesh RID maps directly to its MultiMeshRenderer. Ensure std::hash<godot::RID> is available below.
     std::unordered_map<RendererType, std::unordered_map<godot::RID, MultiMeshRenderer>> renderers_by_type;
+
+    // Threads that large renderers are packed on, shared by all renderers. Null when everything is packed on the main thread.
+    std::shared_ptr<utilities::ParallelFor> packing_workers;
 };
 
 
@@ -64,4 +186,27 @@ inline FlecsRegistry register_entity_rendering_components([](flecs::world& world
         .member<float>("g")
         .member<float>("b")
         .member<float>("a");
+
+    world.component<PreviousTransform2D>("PreviousTransform2D")
+        .member<godot::Transform2D>("value");
+
+    world.component<PreviousTransform3D>("PreviousTransform3D")
+        .member<godot::Transform3D>("value");
+
+    world.component<PreviousPosition2D>("PreviousPosition2D")
+        .member<godot::Vector2>("value");
+
+    world.component<DrawOrderCamera>("DrawOrderCamera")
+        .add(flecs::Singleton);
+
+    world.component<CameraRect>("CameraRect")
+        .add(flecs::Singleton);
+
+    world.component<OnScreen>("OnScreen")
+        .add(flecs::CanToggle);
+
+    world.component<RenderInterpolation>("RenderInterpolation")
+        .add(flecs::Singleton)
+        .member<bool>("enabled")
+        .member<float>("alpha");
 });
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+// Read-only view of bulk data that GDScript writes once per frame as a packed array (PackedVector2Array, PackedFloat32Array, ...).
+// `storage` holds a reference to the packed array's copy-on-write buffer, so setting a channel shares the buffer instead of
+// copying it, and systems read the elements as a plain pointer with a count without touching Variants.
+template <typename ElementT>
+struct PackedChannel {
+    std::shared_ptr<const void> storage;
+    const ElementT* values = nullptr;
+    int64_t count = 0;
+
+    const ElementT* begin() const { return values; }
+    const ElementT* end() const { return values + count; }
+    bool empty() const { return count == 0; }
+};
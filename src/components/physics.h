@@ -1,12 +1,14 @@
 #pragma once
 
 #include <cstdint>
+#include <unordered_map>
 #include <vector>
 
 #include <godot_cpp/classes/physics_server2d.hpp>
 #include <godot_cpp/classes/physics_server3d.hpp>
 #include <godot_cpp/classes/shape2d.hpp>
 #include <godot_cpp/classes/shape3d.hpp>
+#include <godot_cpp/variant/callable.hpp>
 #include <godot_cpp/variant/rid.hpp>
 #include <godot_cpp/variant/transform2d.hpp>
 #include <godot_cpp/variant/transform3d.hpp>
@@ -16,6 +18,7 @@
 
 #include "src/flecs_registry.h"
 #include "src/flecs_singleton_registry.h"
+#include "src/utilities/world_snapshot.h"
 
 
 struct Velocity2D
@@ -47,6 +50,31 @@ struct PhysicsBodyInstance2D
     godot::RID body_rid;
 };
 
+// The transform and velocity last exchanged with the physics server, either pushed by the sync systems or read back by the
+// feedback system. Bodies are only pushed values that differ. Added along with the body instance.
+struct PhysicsBodySync2D
+{
+    godot::Transform2D transform;
+    godot::Vector2 velocity;
+};
+
+// The transform and velocity of a body that moved during a physics step, as its state sync callback reported them
+struct PhysicsBodyState2D
+{
+    flecs::entity_t entity;
+    godot::Transform2D transform;
+    godot::Vector2 velocity;
+};
+
+// Filled from the state sync callbacks of the bodies (FlecsWorld::queue_physics_body_state_2d(), bound to each body's entity id)
+// at the start of each frame, and drained by the feedback system. The physics server only calls them for bodies that moved.
+// sync_callback points at the Callable FlecsWorld owns; null without one (e.g. in the benchmark), and bodies then report nothing.
+struct PhysicsBodyStates2D
+{
+    const godot::Callable* sync_callback = nullptr;
+    std::vector<PhysicsBodyState2D> states;
+};
+
 struct PhysicsSpace2D
 {
     godot::RID space_rid;
@@ -73,6 +101,38 @@ struct PhysicsBodyInstance3D
     godot::RID body_rid;
 };
 
+struct PhysicsBodySync3D
+{
+    godot::Transform3D transform;
+    godot::Vector3 velocity;
+};
+
+struct PhysicsBodyState3D
+{
+    flecs::entity_t entity;
+    godot::Transform3D transform;
+    godot::Vector3 velocity;
+};
+
+struct PhysicsBodyStates3D
+{
+    const godot::Callable* sync_callback = nullptr;
+    std::vector<PhysicsBodyState3D> states;
+};
+
+// Entities that got their shapes and wait for a body, queued by the physics body instantiation observers. Flushed once per frame
+// while there is a physics space, and held until update_physics_spaces() installs one otherwise. Whether a prefab's shapes can
+// make a body is checked for its first instance only (see get_physics_body_prefab()).
+template<typename ShapesT>
+struct PendingPhysicsBodies
+{
+    std::vector<flecs::entity_t> entities;
+    std::unordered_map<flecs::entity_t, bool> valid_prefab_shapes;
+};
+
+using PendingPhysicsBodies2D = PendingPhysicsBodies<PhysicsBodyShapes2D>;
+using PendingPhysicsBodies3D = PendingPhysicsBodies<PhysicsBodyShapes3D>;
+
 struct PhysicsSpace3D
 {
     godot::RID space_rid;
@@ -80,6 +140,28 @@ struct PhysicsSpace3D
     operator godot::Variant() const { return space_rid; }
 };
 
+namespace
+{
+    template<typename StatesT, typename ServerT>
+    inline void bind_body_state_sync_callback(ServerT* physics_server, flecs::entity entity, const godot::RID& body_rid)
+    {
+        const StatesT* body_states = entity.world().template try_get<StatesT>();
+        if (!body_states || !body_states->sync_callback || !body_states->sync_callback->is_valid()) { return; }
+        physics_server->body_set_state_sync_callback(body_rid, body_states->sync_callback->bind(static_cast<int64_t>(entity.id())));
+    }
+}
+
+// Has the physics server report the body's state to the PhysicsBodyStates queue whenever the body moves
+inline void set_body_state_sync_callback(godot::PhysicsServer2D* physics_server, flecs::entity entity, const godot::RID& body_rid)
+{
+    bind_body_state_sync_callback<PhysicsBodyStates2D>(physics_server, entity, body_rid);
+}
+
+inline void set_body_state_sync_callback(godot::PhysicsServer3D* physics_server, flecs::entity entity, const godot::RID& body_rid)
+{
+    bind_body_state_sync_callback<PhysicsBodyStates3D>(physics_server, entity, body_rid);
+}
+
 inline FlecsRegistry register_physics_components([](flecs::world& world) {
     world.component<Velocity2D>("Velocity2D")
         .member<godot::Vector2>("value");
@@ -87,13 +169,36 @@ inline FlecsRegistry register_physics_components([](flecs::world& world) {
     world.component<Velocity3D>("Velocity3D")
         .member<godot::Vector3>("value");
 
-    world.component<PhysicsBodyShapes2D>("PhysicsBodyShapes2D");
-    world.component<PhysicsBodyInstance2D>("PhysicsBodyInstance2D");
+    // Instances share their prefab's shapes instead of copying them, which also tells apart the instances that set their own
+    // (see get_physics_body_prefab())
+    world.component<PhysicsBodyShapes2D>("PhysicsBodyShapes2D")
+        .add(flecs::OnInstantiate, flecs::Inherit);
+    world.component<PhysicsBodySync2D>("PhysicsBodySync2D");
+    world.component<PhysicsBodyInstance2D>("PhysicsBodyInstance2D")
+        .add(flecs::With, world.component<PhysicsBodySync2D>());
     world.component<PhysicsSpace2D>("PhysicsSpace2D").add(flecs::Singleton);
-    world.component<PhysicsBodyShapes3D>("PhysicsBodyShapes3D");
-    world.component<PhysicsBodyInstance3D>("PhysicsBodyInstance3D");
+    world.component<PhysicsBodyShapes3D>("PhysicsBodyShapes3D")
+        .add(flecs::OnInstantiate, flecs::Inherit);
+    world.component<PhysicsBodySync3D>("PhysicsBodySync3D");
+    world.component<PhysicsBodyInstance3D>("PhysicsBodyInstance3D")
+        .add(flecs::With, world.component<PhysicsBodySync3D>());
     world.component<PhysicsSpace3D>("PhysicsSpace3D").add(flecs::Singleton);
 
+    world.component<PendingPhysicsBodies2D>("PendingPhysicsBodies2D").add(flecs::Singleton);
+    world.component<PendingPhysicsBodies3D>("PendingPhysicsBodies3D").add(flecs::Singleton);
+    world.set<PendingPhysicsBodies2D>({});
+    world.set<PendingPhysicsBodies3D>({});
+    world.component<PhysicsBodyStates2D>("PhysicsBodyStates2D").add(flecs::Singleton);
+    world.component<PhysicsBodyStates3D>("PhysicsBodyStates3D").add(flecs::Singleton);
+    world.set<PhysicsBodyStates2D>({});
+    world.set<PhysicsBodyStates3D>({});
+
+    // Body RIDs are freed when the component is removed, a snapshot of them would refer to freed bodies
+    exclude_from_snapshots<PhysicsBodyInstance2D>(world);
+    exclude_from_snapshots<PhysicsBodyInstance3D>(world);
+    exclude_from_snapshots<PhysicsBodySync2D>(world);
+    exclude_from_snapshots<PhysicsBodySync3D>(world);
+
     register_singleton_getter<PhysicsSpace2D>("PhysicsSpace2D");
     register_singleton_setter<godot::RID>("PhysicsSpace2D", [](flecs::world& world, const godot::RID& space_rid) {
         world.set<PhysicsSpace2D>({ space_rid });
@@ -33,6 +33,16 @@ struct Scale3D {
 };
 
 
+// Tags 2D entities that never rotate or scale. They have a Position2D but no Transform2D (nor Rotation2D and Scale2D), so
+// "Transform2D Update" skips them and entity renderers pack their Position2D with an identity basis.
+// Not for physics bodies, which are synced through their Transform2D.
+struct TranslationOnly2D {};
+
+// Tags 3D entities whose Transform3D nothing but the renderer would read. They have Position3D, Rotation3D and Scale3D but no
+// Transform3D, and entity renderers compose their MultiMesh rows straight from those. Not for physics bodies either.
+struct ComposedTransform3D {};
+
+
 inline FlecsRegistry register_transform_components([](flecs::world& world) {
 
     world.component<Position2D>("Position2D")
@@ -55,4 +65,9 @@ inline FlecsRegistry register_transform_components([](flecs::world& world) {
     world.component<Scale3D>("Scale3D")
         .member<godot::Vector3>("value");
 
+
+    world.component<TranslationOnly2D>("TranslationOnly2D");
+
+    world.component<ComposedTransform3D>("ComposedTransform3D");
+
 });
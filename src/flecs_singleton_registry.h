@@ -1,6 +1,7 @@
 #pragma once
 
 #include <functional>
+#include <memory>
 #include <string>
 #include <unordered_map>
 
@@ -59,3 +60,20 @@ void register_singleton_setter(const std::string& name, std::function<void(flecs
         }
     };
 }
+
+// Registers a setter for a PackedChannel-based singleton (see src/components/packed_channel.h). ChannelT must derive from
+// PackedChannel<ElementT> where ElementT matches the packed array's element type, e.g. godot::Vector2 for PackedVector2Array.
+template <typename ChannelT, typename PackedArrayT>
+void register_packed_channel_setter(const std::string& name)
+{
+    register_singleton_setter<PackedArrayT>(name, [](flecs::world& world, const PackedArrayT& packed_values) {
+        // Copying a packed array only takes a reference to its buffer
+        std::shared_ptr<const PackedArrayT> storage = std::make_shared<const PackedArrayT>(packed_values);
+
+        ChannelT channel;
+        channel.values = storage->ptr();
+        channel.count = storage->size();
+        channel.storage = storage;
+        world.set<ChannelT>(channel);
+    });
+}
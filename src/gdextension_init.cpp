@@ -4,6 +4,7 @@
 
 #include "src/gdextension_init.h"
 #include "src/world.h"
+#include "src/utilities/platform.h"
 
 using godot::MODULE_INITIALIZATION_LEVEL_SCENE;
 using godot::ModuleInitializationLevel;
@@ -15,6 +16,8 @@ void initialize_flecs_module(ModuleInitializationLevel p_level)
         return;
     }
 
+    utilities::Platform::register_project_settings();
+
     GDREGISTER_RUNTIME_CLASS(FlecsWorld);
 }
 
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <godot_cpp/variant/dictionary.hpp>
+
+#include <flecs.h>
+
+// Native parameter block of an on-demand system. The GDScript Dictionary is decoded into it once, before the run,
+// and the system receives a pointer to the decoded block through it.param().
+struct SystemParameterBlock
+{
+    virtual ~SystemParameterBlock() = default;
+    virtual bool decode(const flecs::world& world, const godot::Dictionary& parameters) = 0;
+    virtual void* get() = 0;
+};
+
+// ParametersT must be default constructible and provide
+// static bool decode(const flecs::world& world, const godot::Dictionary& parameters, ParametersT& out);
+// which reports errors itself and returns false when the parameters are invalid.
+template <typename ParametersT>
+struct TypedSystemParameterBlock : SystemParameterBlock
+{
+    ParametersT value;
+
+    bool decode(const flecs::world& world, const godot::Dictionary& parameters) override
+    {
+        value = ParametersT{};
+        return ParametersT::decode(world, parameters, value);
+    }
+
+    void* get() override
+    {
+        return &value;
+    }
+};
+
+using SystemParameterBlockFactory = std::function<std::unique_ptr<SystemParameterBlock>()>;
+
+inline std::unordered_map<std::string, SystemParameterBlockFactory>& get_system_parameter_factories()
+{
+    static std::unordered_map<std::string, SystemParameterBlockFactory> factories;
+    return factories;
+}
+
+// Declares the native parameter type of a system. Systems without a declared type receive the raw godot::Dictionary.
+template <typename ParametersT>
+void register_system_parameters(const std::string& system_name)
+{
+    get_system_parameter_factories()[system_name] = []() -> std::unique_ptr<SystemParameterBlock> {
+        return std::make_unique<TypedSystemParameterBlock<ParametersT>>();
+    };
+}
@@ -1,6 +1,8 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <cstring>
+#include <type_traits>
 
 #include <godot_cpp/classes/rendering_server.hpp>
 #include <godot_cpp/variant/packed_float32_array.hpp>
@@ -20,6 +22,7 @@
 #include "src/flecs_registry.h"
 #include "src/components/entity_rendering.h"
 #include "src/utilities/godot_hashes.h"
+#include "src/utilities/multimesh_packing.h"
 
 using godot::Color;
 using godot::PackedFloat32Array;
@@ -28,121 +31,181 @@ using godot::Transform2D;
 using godot::Transform3D;
 using godot::UtilityFunctions;
 
-// Buffer format: https://docs.godotengine.org/en/stable/classes/class_renderingserver.html#class-renderingserver-method-multimesh-set-buffer
-// The per - instance data size and expected data order is :
-// 2D :
-//     - Position : 8 floats(8 floats for Transform2D)
-//     - Position + Vertex color : 12 floats(8 floats for Transform2D, 4 floats for Color)
-//     - Position + Custom data : 12 floats(8 floats for Transform2D, 4 floats of custom data)
-//     - Position + Vertex color + Custom data : 16 floats(8 floats for Transform2D, 4 floats for Color, 4 floats of custom data)
-// 3D :
-//     - Position : 12 floats(12 floats for Transform3D)
-//     - Position + Vertex color : 16 floats(12 floats for Transform3D, 4 floats for Color)
-//     - Position + Custom data : 16 floats(12 floats for Transform3D, 4 floats of custom data)
-//     - Position + Vertex color + Custom data : 20 floats(12 floats for Transform3D, 4 floats for Color, 4 floats of custom data)
-// 
-// Instance transforms are in row - major order.Specifically:
-// For Transform2D the float - order is : (x.x, y.x, padding_float, origin.x, x.y, y.y, padding_float, origin.y).
-// For Transform3D the float - order is : (basis.x.x, basis.y.x, basis.z.x, origin.x, basis.x.y, basis.y.y, basis.z.y, origin.y, basis.x.z, basis.y.z, basis.z.z, origin.z).
-
-
-extern std::unordered_map<godot::RID, PackedFloat32Array> g_multimesh_buffer_cache;
+// Makes room for at least instance_count instances: reallocates the MultiMesh (which drops its contents on the server) and resizes
+// the buffer ring, so the next update repacks every row. Never shrinks.
+inline void reserve_renderer_capacity(MultiMeshRenderer& renderer, size_t instance_count)
+{
+    if (instance_count <= renderer.instance_count || renderer.multimesh.is_null()) {
+        return;
+    }
+
+    UtilityFunctions::print_verbose(
+        godot::String("Entity Rendering (MultiMesh): Growing '") + renderer.name + "' from " +
+        godot::String::num_int64(renderer.instance_count) + " to " + godot::String::num_int64(instance_count) + " instances");
+
+    // Through the resource rather than the RenderingServer, so MultiMesh.instance_count stays in sync for scripts
+    renderer.multimesh->set_instance_count(static_cast<int32_t>(instance_count));
+    renderer.instance_count = instance_count;
+
+    const int64_t buffer_size = static_cast<int64_t>(instance_count * utilities::get_multimesh_row_floats(
+        renderer.transform_format == godot::MultiMesh::TRANSFORM_3D, renderer.use_colors, renderer.use_custom_data));
+    for (PackedFloat32Array& buffer : renderer.buffers) {
+        buffer.resize(buffer_size);
+    }
+    renderer.needs_upload = true;
+}
 
 // Collect instances for a single prefab and update the corresponding multimesh buffer.
 // This helper builds a query specialized for the transform type (2D or 3D) and
 // conditionally includes vertex colors and custom data as query terms when the renderer expects them.
+// Field 1 is the optional previous-tick transform, which is blended in when interpolation_alpha is below 1.
+// Entities rendered from their transform components (component_queries) are packed after the rest: TranslationOnly2D entities
+// with an identity basis, ComposedTransform3D entities composed from their position, rotation and scale.
+//
+// The queries detect changes: when none of them changed since the last upload, the renderer is skipped entirely. Otherwise only the
+// tables that changed are repacked, as long as the rows before them are laid out as in the last upload; the rows of the others are
+// copied over from the previous buffer of the renderer's ring.
+//
+// Packing takes two passes. The query pass assigns each table its first buffer row (a running sum of the table sizes) and records
+// its columns as a span; the MultiMesh is grown when the sum exceeds its instance count. The spans are then packed with the
+// renderer's kernel (specialised for its buffer layout), split over `packing_workers` for large renderers. Rows land in the same
+// place either way, so the buffer doesn't depend on the thread count.
+//
+// Renderers with a draw order pack into their unsorted staging rows instead, together with one sort key per row, and copy the rows
+// into the buffer in key order at the end (see utilities::DrawOrderSorter).
 template <typename TransformType>
 void update_renderer_for_prefab(
     RenderingServer* rendering_server,
-    const MultiMeshRenderer& renderer)
+    MultiMeshRenderer& renderer,
+    float interpolation_alpha,
+    const DrawOrderCamera* camera,
+    utilities::ParallelFor* packing_workers)
 {
-    size_t floats_per_instance = 0;
-    if (renderer.transform_format == godot::MultiMesh::TRANSFORM_2D) {
-        floats_per_instance = 8;
-    }
-    else { // TRANSFORM_3D
-        floats_per_instance = 12;
+    renderer.uploaded_bytes = 0;
+    const bool interpolate_renderer = interpolation_alpha < 1.0f && !renderer.is_static;
+    // Camera depth keys change whenever the camera moves, so those renderers are re-keyed every frame. Culled renderers are too:
+    // toggling OnScreen doesn't count as a change to the table.
+    const bool reuse_unchanged_rows = !interpolate_renderer && !renderer.needs_upload && renderer.draw_order != DrawOrder::CameraDepth && !renderer.cull;
+    if (reuse_unchanged_rows)
+    {
+        bool any_query_changed = false;
+        for (const std::vector<flecs::query<>>* queries : { &renderer.queries, &renderer.component_queries }) {
+            for (const auto& q : *queries) {
+                any_query_changed = any_query_changed || q.changed();
+            }
+        }
+        if (!any_query_changed) {
+            return; // Buffer and visible instance count are still current
+        }
     }
 
-    floats_per_instance += (renderer.use_colors ? 4 : 0) + (renderer.use_custom_data ? 4 : 0);
+    const size_t floats_per_instance = utilities::get_multimesh_row_floats(
+        renderer.transform_format == godot::MultiMesh::TRANSFORM_3D, renderer.use_colors, renderer.use_custom_data);
 
-    PackedFloat32Array& buffer = g_multimesh_buffer_cache[renderer.rid];
-    size_t required_size = renderer.instance_count * floats_per_instance;
-    if (buffer.size() != required_size) {
-        UtilityFunctions::push_warning(
-            godot::String("Entity Rendering (MultiMesh): Resizing MultiMesh buffer from ") +
-            godot::String::num_int64(buffer.size()) + godot::String(" to ") +
-            godot::String::num_int64(required_size));
-        buffer.resize(required_size);
-    }
+    // The previous buffer of the ring (the last upload) still holds the rows of unchanged tables. Sorted renderers keep their
+    // unsorted rows in staging_rows instead.
+    const PackedFloat32Array& previous_buffer = renderer.buffers[renderer.buffer_index];
+    const bool sorted = renderer.draw_order != DrawOrder::None;
+    bool layout_unchanged = reuse_unchanged_rows && (sorted || previous_buffer.size() == renderer.instance_count * floats_per_instance);
 
-    float* buffer_ptr = buffer.ptrw();
     size_t instance_count = 0;
+    size_t range_idx = 0;
+    renderer.previous_ranges.swap(renderer.uploaded_ranges);
+    renderer.uploaded_ranges.clear();
+    renderer.spans.clear();
+    renderer.reused_rows.clear();
 
-    // Each renderer can have multiple queries (one per prefab). Iterate all queries and append matching instances
-    // to the buffer until the renderer's instance_count is reached.
-    for (const auto& q : renderer.queries) {
-        q.run([&](flecs::iter& it) {
-            while (it.next()) {
-                auto transform_field = it.field<const TransformType>(0);
+    // Each renderer can have multiple queries (one per prefab). Iterate all queries and assign consecutive rows to the matching
+    // instances; the capacity is checked once all of them are counted. `source` is the type of field 0.
+    auto collect_spans = [&](const std::vector<flecs::query<>>& queries, auto source) {
+        using SourceType = decltype(source);
+        for (const auto& q : queries) {
+            q.run([&](flecs::iter& it) {
+                while (it.next()) {
+                    const RenderedTableRange range{ it.c_ptr()->table, it.c_ptr()->offset, static_cast<int32_t>(it.count()) };
+                    layout_unchanged = layout_unchanged && range_idx < renderer.previous_ranges.size() && renderer.previous_ranges[range_idx] == range;
+                    renderer.uploaded_ranges.push_back(range);
+                    range_idx++;
 
-                for (auto i : it) {
-                    if (instance_count >= renderer.instance_count) {
-                        break;
+                    const size_t row_count = it.count();
+                    if (layout_unchanged && !it.changed()) {
+                        // Same rows as in the last upload and nothing wrote to the table since
+                        if (!sorted && row_count > 0) {
+                            renderer.reused_rows.push_back({ instance_count, row_count });
+                        }
+                        instance_count += row_count;
+                        it.skip();
+                        continue;
                     }
 
-                    size_t buffer_cursor = instance_count * floats_per_instance;
-                    const TransformType& transform = transform_field[i];
-
-                    if constexpr (std::is_same_v<TransformType, Transform2D>) {
-                        buffer_ptr[buffer_cursor++] = transform.columns[0].x;
-                        buffer_ptr[buffer_cursor++] = transform.columns[1].x;
-                        buffer_ptr[buffer_cursor++] = 0.0f;
-                        buffer_ptr[buffer_cursor++] = transform.columns[2].x;
-                        buffer_ptr[buffer_cursor++] = transform.columns[0].y;
-                        buffer_ptr[buffer_cursor++] = transform.columns[1].y;
-                        buffer_ptr[buffer_cursor++] = 0.0f;
-                        buffer_ptr[buffer_cursor++] = transform.columns[2].y;
-                    }
-                    else if constexpr (std::is_same_v<TransformType, Transform3D>) {
-                        buffer_ptr[buffer_cursor++] = transform.basis.rows[0][0];
-                        buffer_ptr[buffer_cursor++] = transform.basis.rows[0][1];
-                        buffer_ptr[buffer_cursor++] = transform.basis.rows[0][2];
-                        buffer_ptr[buffer_cursor++] = transform.origin.x;
-                        buffer_ptr[buffer_cursor++] = transform.basis.rows[1][0];
-                        buffer_ptr[buffer_cursor++] = transform.basis.rows[1][1];
-                        buffer_ptr[buffer_cursor++] = transform.basis.rows[1][2];
-                        buffer_ptr[buffer_cursor++] = transform.origin.y;
-                        buffer_ptr[buffer_cursor++] = transform.basis.rows[2][0];
-                        buffer_ptr[buffer_cursor++] = transform.basis.rows[2][1];
-                        buffer_ptr[buffer_cursor++] = transform.basis.rows[2][2];
-                        buffer_ptr[buffer_cursor++] = transform.origin.z;
+                    if (row_count > 0) {
+                        renderer.spans.push_back(utilities::make_pack_span<SourceType>(it, interpolate_renderer, renderer.use_colors, renderer.use_custom_data,
+                            static_cast<uint32_t>(instance_count), static_cast<uint32_t>(row_count)));
+                        instance_count += row_count;
                     }
-
-                    int next_field_idx = 1;
-                    if (renderer.use_colors) {
-                        const RenderingColor& color = it.field<const RenderingColor>(next_field_idx++)[i];
-                        buffer_ptr[buffer_cursor++] = color.r;
-                        buffer_ptr[buffer_cursor++] = color.g;
-                        buffer_ptr[buffer_cursor++] = color.b;
-                        buffer_ptr[buffer_cursor++] = color.a;
-                    }
-                    if (renderer.use_custom_data) {
-                        const RenderingCustomData& custom_data = it.field<const RenderingCustomData>(next_field_idx++)[i];
-                        buffer_ptr[buffer_cursor++] = custom_data.r;
-                        buffer_ptr[buffer_cursor++] = custom_data.g;
-                        buffer_ptr[buffer_cursor++] = custom_data.b;
-                        buffer_ptr[buffer_cursor++] = custom_data.a;
-                    }
-                    instance_count++;
                 }
-            }
-        });
-        if (instance_count >= renderer.instance_count) break;
+            });
+        }
+    };
+    collect_spans(renderer.queries, TransformType{});
+    collect_spans(renderer.component_queries, utilities::TransformComponentsFor<TransformType>{});
+
+    if (instance_count > renderer.instance_count) {
+        // Grow geometrically, so a steadily growing population only reallocates a handful of times.
+        // Spawners can avoid even that by reserving ahead of a wave (FlecsWorld::reserve_renderer_capacity).
+        reserve_renderer_capacity(renderer, std::max(instance_count, renderer.instance_count * 2));
+    }
+
+    // Write into the next buffer of the ring
+    renderer.buffer_index = (renderer.buffer_index + 1) % MULTIMESH_BUFFER_RING_SIZE;
+    PackedFloat32Array& buffer = renderer.buffers[renderer.buffer_index];
+    const size_t required_size = renderer.instance_count * floats_per_instance;
+
+    // ptrw() copies the array when the server still references it; the ring should make that impossible
+    const float* shared_buffer_ptr = buffer.ptr();
+    float* buffer_ptr = buffer.ptrw();
+    if (buffer_ptr != shared_buffer_ptr) {
+        renderer.buffer_copies++;
+    }
+
+    utilities::MultiMeshPackTarget target{};
+    target.interpolation_alpha = interpolation_alpha;
+    if (sorted) {
+        renderer.staging_rows.resize(required_size);
+        renderer.sort_keys.resize(renderer.instance_count);
+        target.rows = renderer.staging_rows.data();
+        target.sort_keys = renderer.sort_keys.data();
+        utilities::set_draw_order_key(target, renderer.draw_order, camera);
+    }
+    else {
+        target.rows = buffer_ptr;
+    }
+
+    // Column pointers stay valid: nothing changes the tables between the query pass and here
+    utilities::pack_spans(renderer.pack_kernel, renderer.spans, instance_count, target, packing_workers);
+
+    const size_t row_bytes = floats_per_instance * sizeof(float);
+    if (sorted) {
+        // The previous order stays the starting point when spawns, deaths or culling shift rows; the sorter's move budget
+        // decides whether fixing it up still pays off
+        const std::vector<uint32_t>& sorted_rows = renderer.sorter.sort(renderer.sort_keys.data(), instance_count);
+        for (size_t row_idx = 0; row_idx < instance_count; ++row_idx) {
+            std::memcpy(buffer_ptr + row_idx * floats_per_instance, target.rows + sorted_rows[row_idx] * floats_per_instance, row_bytes);
+        }
+    }
+    else {
+        const float* previous_buffer_ptr = previous_buffer.ptr();
+        for (const std::pair<size_t, size_t>& rows : renderer.reused_rows) {
+            std::memcpy(buffer_ptr + rows.first * floats_per_instance, previous_buffer_ptr + rows.first * floats_per_instance, rows.second * row_bytes);
+        }
     }
 
+    // Blended rows are only valid for this frame's alpha, so they can't be reused by the next upload
+    renderer.needs_upload = interpolate_renderer;
+
     rendering_server->multimesh_set_buffer(renderer.rid, buffer);
     rendering_server->multimesh_set_visible_instances(renderer.rid, instance_count);
+    renderer.uploaded_bytes = static_cast<int64_t>(buffer.size()) * static_cast<int64_t>(sizeof(float));
 }
 
 
@@ -150,18 +213,19 @@ inline FlecsRegistry register_entity_rendering_multimesh_system([](flecs::world&
 {
     // This system iterates over all MultiMesh renderers and updates their buffers.
     // It's designed to be efficient by using pre-built queries stored in the MultiMeshRenderer component.
+    // It runs on demand from FlecsWorld::progress() once per display frame, after however many simulation ticks were taken.
     world.system("Entity Rendering (MultiMesh)")
-        .kind(flecs::OnStore)
+        .kind(0) // On-demand
         .run([](flecs::iter& it) {
 
-        if (!it.world().has<EntityRenderers>())
+        EntityRenderers* renderers = it.world().try_get_mut<EntityRenderers>();
+        if (renderers == nullptr)
         {
             return; // No renderers component
         }
-        const EntityRenderers& renderers = it.world().get<EntityRenderers>();
 
-        auto multimesh_renderers_it = renderers.renderers_by_type.find(RendererType::MultiMesh);
-        if (multimesh_renderers_it == renderers.renderers_by_type.end())
+        auto multimesh_renderers_it = renderers->renderers_by_type.find(RendererType::MultiMesh);
+        if (multimesh_renderers_it == renderers->renderers_by_type.end())
         {
             return; // No multimesh renderers
         }
@@ -173,18 +237,86 @@ inline FlecsRegistry register_entity_rendering_multimesh_system([](flecs::world&
             return;
         }
 
+        const RenderInterpolation* interpolation = it.world().try_get<RenderInterpolation>();
+        const float interpolation_alpha = interpolation != nullptr && interpolation->enabled ? interpolation->alpha : 1.0f;
+        const DrawOrderCamera* camera = it.world().try_get<DrawOrderCamera>();
+        utilities::ParallelFor* packing_workers = renderers->packing_workers.get();
+
         for (auto& prefab_renderer_pair : multimesh_renderers_it->second)
         {
-            const MultiMeshRenderer& renderer = prefab_renderer_pair.second;
+            MultiMeshRenderer& renderer = prefab_renderer_pair.second;
 
             if (renderer.transform_format == godot::MultiMesh::TRANSFORM_2D)
             {
-                update_renderer_for_prefab<Transform2D>(rendering_server, renderer);
+                update_renderer_for_prefab<Transform2D>(rendering_server, renderer, interpolation_alpha, camera, packing_workers);
             }
             else
             {
-                update_renderer_for_prefab<Transform3D>(rendering_server, renderer);
+                update_renderer_for_prefab<Transform3D>(rendering_server, renderer, interpolation_alpha, camera, packing_workers);
             }
         }
     });
 });
+
+
+inline FlecsRegistry register_viewport_culling_system([](flecs::world& world)
+{
+    // Toggles OnScreen on the entities of culled MultiMesh renderers. Runs on demand from FlecsWorld right before
+    // "Entity Rendering (MultiMesh)", whose culled renderers only match enabled OnScreen tags.
+    // Only entities crossing the rect edge are toggled, so a still camera costs one rect test (and one enabled check) per entity.
+    world.system("Viewport Culling")
+        .kind(0) // On-demand
+        .run([](flecs::iter& it) {
+
+        const EntityRenderers* renderers = it.world().try_get<EntityRenderers>();
+        if (renderers == nullptr)
+        {
+            return;
+        }
+        auto multimesh_renderers_it = renderers->renderers_by_type.find(RendererType::MultiMesh);
+        if (multimesh_renderers_it == renderers->renderers_by_type.end())
+        {
+            return;
+        }
+
+        // Without a camera everything counts as on screen
+        const CameraRect* camera_rect = it.world().try_get<CameraRect>();
+
+        for (const auto& prefab_renderer_pair : multimesh_renderers_it->second)
+        {
+            const MultiMeshRenderer& renderer = prefab_renderer_pair.second;
+            if (!renderer.cull)
+            {
+                continue;
+            }
+
+            const godot::Rect2 cull_rect = camera_rect != nullptr ? camera_rect->rect.grow(renderer.cull_margin) : godot::Rect2();
+            // `source` is the type of field 0: Transform2D, or Position2D for the translation-only entities
+            auto cull_instances = [&](const std::vector<flecs::query<>>& queries, auto source) {
+                using SourceType = decltype(source);
+                for (const auto& q : queries) {
+                    q.run([&](flecs::iter& culling_it) {
+                        while (culling_it.next()) {
+                            auto origin_field = culling_it.field<const SourceType>(0);
+                            for (auto i : culling_it) {
+                                const bool on_screen = camera_rect == nullptr || cull_rect.has_point(utilities::get_instance_origin(origin_field[i]));
+                                flecs::entity entity = culling_it.entity(i);
+                                if (entity.enabled<OnScreen>() != on_screen) {
+                                    // Enabling adds the tag the first time; both are deferred until the system returns
+                                    if (on_screen) {
+                                        entity.enable<OnScreen>();
+                                    }
+                                    else {
+                                        entity.disable<OnScreen>();
+                                    }
+                                }
+                            }
+                        }
+                    });
+                }
+            };
+            cull_instances(renderer.instance_queries, Transform2D{});
+            cull_instances(renderer.component_instance_queries, Position2D{});
+        }
+    });
+});
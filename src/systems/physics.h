@@ -2,8 +2,10 @@
 
 #include <godot_cpp/classes/physics_server2d.hpp>
 #include <godot_cpp/classes/physics_server3d.hpp>
+#include <godot_cpp/variant/basis.hpp>
 #include <godot_cpp/variant/transform2d.hpp>
 #include <godot_cpp/variant/transform3d.hpp>
+#include <godot_cpp/variant/utility_functions.hpp>
 #include <godot_cpp/variant/variant.hpp>
 #include <godot_cpp/variant/vector2.hpp>
 #include <godot_cpp/variant/vector3.hpp>
@@ -11,6 +13,7 @@
 #include "src/components/physics.h"
 #include "src/components/transform.h"
 #include "src/flecs_registry.h"
+#include "src/utilities/physics_body_pool.h"
 
 namespace
 {
@@ -36,64 +39,142 @@ namespace
         if (!physics_space->space_rid.is_valid()) { return false; }
         if (body_definition.shapes.empty()) { return false; }
 
-        godot::RID body_rid = physics_server->body_create();
-        physics_server->body_set_mode(body_rid, body_definition.body_mode);
-        physics_server->body_set_space(body_rid, physics_space->space_rid);
-        physics_server->body_set_collision_layer(body_rid, body_definition.collision_layer);
-        physics_server->body_set_collision_mask(body_rid, body_definition.collision_mask);
-
-        int added_shapes = 0;
-        for (const ShapeDefinitionT& shape_def : body_definition.shapes)
+        // Reuse a parked body of the same prefab when there is one, it's already set up
+        PhysicsBodyPool<ServerT>* body_pool = world.try_get_mut<PhysicsBodyPool<ServerT>>();
+        godot::RID body_rid = body_pool
+            ? body_pool->unpark(physics_server, get_physics_body_prefab<ShapesT>(entity), physics_space->space_rid)
+            : godot::RID();
+        if (!body_rid.is_valid())
         {
-            if (shape_def.shape.is_null()) { continue; }
-            physics_server->body_add_shape(body_rid, shape_def.shape->get_rid(), shape_def.local_transform);
-            added_shapes++;
-        }
+            body_rid = physics_server->body_create();
+            physics_server->body_set_mode(body_rid, body_definition.body_mode);
+            physics_server->body_set_space(body_rid, physics_space->space_rid);
+            physics_server->body_set_collision_layer(body_rid, body_definition.collision_layer);
+            physics_server->body_set_collision_mask(body_rid, body_definition.collision_mask);
 
-        if (added_shapes == 0)
-        {
-            physics_server->free_rid(body_rid);
-            return false;
+            int added_shapes = 0;
+            for (const ShapeDefinitionT& shape_def : body_definition.shapes)
+            {
+                if (shape_def.shape.is_null()) { continue; }
+                physics_server->body_add_shape(body_rid, shape_def.shape->get_rid(), shape_def.local_transform);
+                added_shapes++;
+            }
+
+            if (added_shapes == 0)
+            {
+                physics_server->free_rid(body_rid);
+                return false;
+            }
         }
 
         physics_server->body_set_state(body_rid, transform_state, transform);
+        set_body_state_sync_callback(physics_server, entity, body_rid);
         entity.set<InstanceT>({ body_rid });
         return true;
     }
 
-    template<typename TransformT, typename InstanceT, typename ServerT, typename BodyStateT>
+    // The SyncT column of the iterated table. The sync systems query SyncT as [in] and write the last exchanged values through
+    // this instead, so that recording them doesn't count as a change to the table on the next frame.
+    template<typename SyncT>
+    inline SyncT* get_sync_column(flecs::iter& it)
+    {
+        const ecs_iter_t* iter = it.c_ptr();
+        return static_cast<SyncT*>(ecs_table_get_id(iter->world, iter->table, it.world().template id<SyncT>(), iter->offset));
+    }
+
+    // Pushes the transforms the ECS changed to the physics server. Tables nothing wrote to since the last sync are skipped
+    // whole (change detection); in the others only bodies whose transform differs from the last one exchanged are pushed.
+    template<typename TransformT, typename InstanceT, typename SyncT, typename ServerT, typename BodyStateT>
     inline void register_physics_sync_system(
         flecs::world& world,
         const char* system_name,
         BodyStateT body_state)
     {
-        world.system<const TransformT, const InstanceT>(system_name)
+        world.system<const TransformT, const InstanceT, const SyncT>(system_name)
             .kind(flecs::PostUpdate)
-            .each([body_state](const TransformT& transform, const InstanceT& instance)
+            .detect_changes()
+            .run([body_state](flecs::iter& it)
         {
             ServerT* physics_server = ServerT::get_singleton();
-            if (!physics_server) { return; }
-            if (!instance.body_rid.is_valid()) { return; }
-            physics_server->body_set_state(instance.body_rid, body_state, transform);
+            while (it.next())
+            {
+                if (!physics_server || !it.changed())
+                {
+                    it.skip(); // Keeps the changes pending
+                    continue;
+                }
+
+                flecs::field<const TransformT> transforms = it.field<const TransformT>(0);
+                flecs::field<const InstanceT> instances = it.field<const InstanceT>(1);
+                SyncT* synced = get_sync_column<SyncT>(it);
+                for (auto i : it)
+                {
+                    if (!instances[i].body_rid.is_valid() || transforms[i] == synced[i].transform) { continue; }
+                    physics_server->body_set_state(instances[i].body_rid, body_state, transforms[i]);
+                    synced[i].transform = transforms[i];
+                }
+            }
         });
     }
 
-    template<typename InstanceT, typename ServerT>
+    // Parks the body of a removed instance in the PhysicsBodyPool for the next instance of its prefab, or frees it when the
+    // prefab's pool is full
+    template<typename InstanceT, typename ShapesT, typename ServerT>
     inline void register_physics_cleanup_observer(
         flecs::world& world,
         const char* observer_name)
     {
         world.observer<const InstanceT>(observer_name)
             .event(flecs::OnRemove)
-            .each([](const InstanceT& instance)
+            .each([](flecs::entity entity, const InstanceT& instance)
         {
             ServerT* physics_server = ServerT::get_singleton();
             if (!physics_server) { return; }
             if (!instance.body_rid.is_valid()) { return; }
+
+            PhysicsBodyPool<ServerT>* body_pool = entity.world().template try_get_mut<PhysicsBodyPool<ServerT>>();
+            const flecs::entity_t prefab = get_physics_body_prefab<ShapesT>(entity);
+            if (body_pool && body_pool->park(physics_server, prefab, instance.body_rid, entity.try_get<PhysicsBodyPoolSize>())) { return; }
             physics_server->free_rid(instance.body_rid);
         });
     }
 
+    // Whether the entity can have a body, checked once per prefab. Warns the first time it can't. Bodies are only synced through
+    // the transform, so entities without one (TranslationOnly2D, ComposedTransform3D) don't get a body.
+    template<typename ShapesT, typename TransformT>
+    inline bool can_have_physics_body(PendingPhysicsBodies<ShapesT>& pending, flecs::entity entity, const ShapesT& body_shapes)
+    {
+        const flecs::entity_t prefab = get_physics_body_prefab<ShapesT>(entity);
+        if (prefab != 0)
+        {
+            auto found = pending.valid_prefab_shapes.find(prefab);
+            if (found != pending.valid_prefab_shapes.end()) { return found->second; }
+        }
+
+        bool is_valid = !body_shapes.shapes.empty();
+        for (const auto& shape_def : body_shapes.shapes)
+        {
+            if (shape_def.shape.is_null()) { is_valid = false; }
+        }
+
+        const godot::String owner_name = prefab != 0 ? entity.world().entity(prefab).name().c_str() : entity.name().c_str();
+        if (!is_valid)
+        {
+            godot::UtilityFunctions::push_warning(godot::String(entity.world().template component<ShapesT>().name().c_str()) + " of '" +
+                owner_name + "' has no shapes or an invalid shape reference, no physics body is created for it.");
+        }
+        else if (!entity.template has<TransformT>())
+        {
+            is_valid = false;
+            godot::UtilityFunctions::push_warning("'" + owner_name + "' has " + entity.world().template component<ShapesT>().name().c_str() +
+                " but no " + entity.world().template component<TransformT>().name().c_str() + ", no physics body is created for it.");
+        }
+        if (prefab != 0) { pending.valid_prefab_shapes.emplace(prefab, is_valid); }
+        return is_valid;
+    }
+
+    // Queues entities for a body when they get their shapes, which prefab instances do when they're created. The bodies are
+    // created at the start of the next frame rather than here, when the spawning code has set the entity's transform.
     template<
         typename ShapesT,
         typename ShapeDefinitionT,
@@ -102,120 +183,139 @@ namespace
         typename TransformT,
         typename InstanceT,
         typename BodyStateT>
-    inline void register_physics_instantiation_system(
+    inline void register_physics_instantiation_observer(
         flecs::world& world,
-        const char* system_name,
+        const char* observer_name,
+        const char* flush_system_name,
         BodyStateT transform_state)
     {
-        world.system<const ShapesT>(system_name)
-            .kind(flecs::OnUpdate)
-            .template without<InstanceT>()
-            .each([transform_state](flecs::iter& it, size_t index, const ShapesT& body_shapes)
+        world.observer<>(observer_name)
+            .template with<ShapesT>()
+            .event(flecs::OnAdd)
+            .each([](flecs::entity entity)
         {
-            flecs::entity entity = it.entity(index);
-            const TransformT* transform = entity.try_get<TransformT>();
-            TransformT initial_transform = transform ? *transform : TransformT();
-            try_create_physics_body<
-                ShapesT,
-                ShapeDefinitionT,
-                SpaceT,
-                ServerT,
-                TransformT,
-                InstanceT>(
-                    it.world(),
-                    entity,
-                    body_shapes,
-                    initial_transform,
-                    transform_state);
+            PendingPhysicsBodies<ShapesT>* pending = entity.world().template try_get_mut<PendingPhysicsBodies<ShapesT>>();
+            if (pending) { pending->entities.push_back(entity.id()); }
+        });
+
+        world.system<>(flush_system_name)
+            .kind(flecs::OnLoad)
+            .run([transform_state](flecs::iter& it)
+        {
+            flecs::world stage_world = it.world();
+            PendingPhysicsBodies<ShapesT>* pending = stage_world.template try_get_mut<PendingPhysicsBodies<ShapesT>>();
+            if (!pending || pending->entities.empty()) { return; }
+
+            // Held until there is a space to put the bodies in
+            const SpaceT* physics_space = stage_world.template try_get<SpaceT>();
+            if (!ServerT::get_singleton() || !physics_space || !physics_space->space_rid.is_valid()) { return; }
+
+            for (flecs::entity_t entity_id : pending->entities)
+            {
+                flecs::entity entity = stage_world.entity(entity_id);
+                if (!entity.is_alive() || entity.template has<InstanceT>()) { continue; }
+
+                const ShapesT* body_shapes = entity.template try_get<ShapesT>();
+                if (!body_shapes || !can_have_physics_body<ShapesT, TransformT>(*pending, entity, *body_shapes)) { continue; }
+
+                try_create_physics_body<
+                    ShapesT,
+                    ShapeDefinitionT,
+                    SpaceT,
+                    ServerT,
+                    TransformT,
+                    InstanceT>(
+                        stage_world,
+                        entity,
+                        *body_shapes,
+                        *entity.template try_get<TransformT>(),
+                        transform_state);
+            }
+            pending->entities.clear();
         });
     }
 
-    template<typename VelocityT, typename InstanceT, typename ServerT, typename BodyStateT>
+    // The same as register_physics_sync_system, for velocities
+    template<typename VelocityT, typename InstanceT, typename SyncT, typename ServerT, typename BodyStateT>
     inline void register_physics_velocity_update_system(
         flecs::world& world,
         const char* system_name,
         BodyStateT velocity_state)
     {
-        world.system<const VelocityT, const InstanceT>(system_name)
+        world.system<const VelocityT, const InstanceT, const SyncT>(system_name)
             .kind(flecs::PostUpdate)
-            .each([velocity_state](const VelocityT& velocity, const InstanceT& instance)
+            .detect_changes()
+            .run([velocity_state](flecs::iter& it)
         {
             ServerT* physics_server = ServerT::get_singleton();
-            if (!physics_server) { return; }
-            if (!instance.body_rid.is_valid()) { return; }
-            physics_server->body_set_state(instance.body_rid, velocity_state, velocity.value);
+            while (it.next())
+            {
+                if (!physics_server || !it.changed())
+                {
+                    it.skip();
+                    continue;
+                }
+
+                flecs::field<const VelocityT> velocities = it.field<const VelocityT>(0);
+                flecs::field<const InstanceT> instances = it.field<const InstanceT>(1);
+                SyncT* synced = get_sync_column<SyncT>(it);
+                for (auto i : it)
+                {
+                    if (!instances[i].body_rid.is_valid() || velocities[i].value == synced[i].velocity) { continue; }
+                    physics_server->body_set_state(instances[i].body_rid, velocity_state, velocities[i].value);
+                    synced[i].velocity = velocities[i].value;
+                }
+            }
         });
     }
 
+    // Scatters the states the bodies reported since the last frame (see PhysicsBodyStates2D) into their entities' transform
+    // components and velocity, and records them as the last exchanged values so the sync systems don't push them straight back.
+    // Only bodies that moved are in the queue, and their states arrive as native values, so nothing goes through a Variant here.
     template<
-        typename InstanceT,
+        typename StatesT,
         typename PositionT,
         typename TransformComponentT,
         typename RotationT,
         typename ScaleT,
         typename VelocityT,
-        typename ServerT,
-        typename BodyStateT,
-        typename TransformAssignmentFn,
-        typename VelocityAssignmentFn>
+        typename SyncT,
+        typename TransformAssignmentFn>
     inline void register_physics_feedback_system(
         flecs::world& world,
         const char* system_name,
-        BodyStateT transform_state,
-        BodyStateT velocity_state,
-        godot::Variant::Type transform_variant_type,
-        godot::Variant::Type velocity_variant_type,
-        TransformAssignmentFn assign_transform,
-        VelocityAssignmentFn assign_velocity)
+        TransformAssignmentFn assign_transform)
     {
-        world.system<
-            InstanceT,
-            PositionT,
-            TransformComponentT,
-            RotationT*,
-            ScaleT*,
-            VelocityT*>(system_name)
+        world.system<>(system_name)
             .kind(flecs::PreUpdate)
-            .term_at(4).optional()
-            .term_at(5).optional()
-            .term_at(6).optional()
-            .each([transform_state,
-                velocity_state,
-                transform_variant_type,
-                velocity_variant_type,
-                assign_transform,
-                assign_velocity](
-                    flecs::iter& it,
-                    size_t index,
-                    InstanceT& instance,
-                    PositionT& position,
-                    TransformComponentT& transform_component,
-                    RotationT* rotation,
-                    ScaleT* scale,
-                    VelocityT* velocity)
+            .run([assign_transform](flecs::iter& it)
         {
-            ServerT* physics_server = ServerT::get_singleton();
-            if (!physics_server) { return; }
-            if (!instance.body_rid.is_valid()) { return; }
+            flecs::world stage_world = it.world();
+            StatesT* body_states = stage_world.template try_get_mut<StatesT>();
+            if (!body_states || body_states->states.empty()) { return; }
 
-            godot::Variant transform_value = physics_server->body_get_state(
-                instance.body_rid,
-                transform_state);
-            if (transform_value.get_type() == transform_variant_type)
+            // A body that moved in several physics steps since the last frame is queued once per step, the last state wins
+            for (const auto& state : body_states->states)
             {
-                assign_transform(transform_value, position, transform_component, rotation, scale);
-            }
+                flecs::entity entity = stage_world.entity(state.entity);
+                if (!entity.is_alive()) { continue; }
 
-            if (velocity)
-            {
-                godot::Variant velocity_value = physics_server->body_get_state(
-                    instance.body_rid,
-                    velocity_state);
-                if (velocity_value.get_type() == velocity_variant_type)
+                PositionT* position = entity.template try_get_mut<PositionT>();
+                TransformComponentT* transform = entity.template try_get_mut<TransformComponentT>();
+                SyncT* synced = entity.template try_get_mut<SyncT>();
+                if (!position || !transform || !synced) { continue; }
+
+                assign_transform(state.transform, *position, *transform, entity.template try_get_mut<RotationT>(), entity.template try_get_mut<ScaleT>());
+                synced->transform = *transform;
+                entity.template modified<TransformComponentT>(); // Written in place, so tell the renderers it changed
+
+                if (VelocityT* velocity = entity.template try_get_mut<VelocityT>())
                 {
-                    assign_velocity(velocity_value, *velocity);
+                    velocity->value = state.velocity;
+                    synced->velocity = state.velocity;
                 }
             }
+            body_states->states.clear();
         });
     }
 }
@@ -223,7 +323,7 @@ namespace
 inline FlecsRegistry register_physics_systems([](flecs::world& world)
 {
     // 2D Physics Systems
-    register_physics_instantiation_system<
+    register_physics_instantiation_observer<
         PhysicsBodyShapes2D,
         PhysicsBodyShape2DDefinition,
         PhysicsSpace2D,
@@ -232,9 +332,10 @@ inline FlecsRegistry register_physics_systems([](flecs::world& world)
         PhysicsBodyInstance2D>(
             world,
             "Physics Body 2D Instantiation",
+            "Physics Body 2D Pending Flush",
             godot::PhysicsServer2D::BODY_STATE_TRANSFORM);
 
-    register_physics_sync_system<godot::Transform2D, PhysicsBodyInstance2D, godot::PhysicsServer2D>(
+    register_physics_sync_system<godot::Transform2D, PhysicsBodyInstance2D, PhysicsBodySync2D, godot::PhysicsServer2D>(
         world,
         "Physics Body 2D Sync",
         godot::PhysicsServer2D::BODY_STATE_TRANSFORM);
@@ -242,50 +343,41 @@ inline FlecsRegistry register_physics_systems([](flecs::world& world)
     register_physics_velocity_update_system<
         Velocity2D,
         PhysicsBodyInstance2D,
+        PhysicsBodySync2D,
         godot::PhysicsServer2D>(
             world,
             "Physics Body 2D Velocity Update",
             godot::PhysicsServer2D::BODY_STATE_LINEAR_VELOCITY);
 
     register_physics_feedback_system<
-        PhysicsBodyInstance2D,
+        PhysicsBodyStates2D,
         Position2D,
         godot::Transform2D,
         Rotation2D,
         Scale2D,
         Velocity2D,
-        godot::PhysicsServer2D>(
+        PhysicsBodySync2D>(
             world,
             "Physics Body 2D Feedback",
-            godot::PhysicsServer2D::BODY_STATE_TRANSFORM,
-            godot::PhysicsServer2D::BODY_STATE_LINEAR_VELOCITY,
-            godot::Variant::TRANSFORM2D,
-            godot::Variant::VECTOR2,
-            [](const godot::Variant& transform_value,
+            [](const godot::Transform2D& physics_transform,
                 Position2D& position,
                 godot::Transform2D& transform_component,
                 Rotation2D* rotation,
                 Scale2D* scale)
     {
-        godot::Transform2D physics_transform = transform_value;
         transform_component = physics_transform;
         position.value = physics_transform.get_origin();
         if (rotation) { rotation->value = physics_transform.get_rotation(); }
         if (scale) { scale->value = physics_transform.get_scale(); }
-    },
-            [](const godot::Variant& velocity_value, Velocity2D& velocity_component)
-    {
-        godot::Vector2 physics_velocity = velocity_value;
-        velocity_component.value = physics_velocity;
     });
 
-    register_physics_cleanup_observer<PhysicsBodyInstance2D, godot::PhysicsServer2D>(
+    register_physics_cleanup_observer<PhysicsBodyInstance2D, PhysicsBodyShapes2D, godot::PhysicsServer2D>(
         world,
         "Physics Body 2D Cleanup");
 
 
     // 3D Physics Systems
-    register_physics_instantiation_system <
+    register_physics_instantiation_observer<
         PhysicsBodyShapes3D,
         PhysicsBodyShape3DDefinition,
         PhysicsSpace3D,
@@ -294,9 +386,10 @@ inline FlecsRegistry register_physics_systems([](flecs::world& world)
         PhysicsBodyInstance3D>(
             world,
             "Physics Body 3D Instantiation",
+            "Physics Body 3D Pending Flush",
             godot::PhysicsServer3D::BODY_STATE_TRANSFORM);
 
-    register_physics_sync_system<godot::Transform3D, PhysicsBodyInstance3D, godot::PhysicsServer3D>(
+    register_physics_sync_system<godot::Transform3D, PhysicsBodyInstance3D, PhysicsBodySync3D, godot::PhysicsServer3D>(
         world,
         "Physics Body 3D Sync",
         godot::PhysicsServer3D::BODY_STATE_TRANSFORM);
@@ -304,44 +397,35 @@ inline FlecsRegistry register_physics_systems([](flecs::world& world)
     register_physics_velocity_update_system<
         Velocity3D,
         PhysicsBodyInstance3D,
+        PhysicsBodySync3D,
         godot::PhysicsServer3D>(
             world,
             "Physics Body 3D Velocity Update",
             godot::PhysicsServer3D::BODY_STATE_LINEAR_VELOCITY);
 
     register_physics_feedback_system<
-        PhysicsBodyInstance3D,
+        PhysicsBodyStates3D,
         Position3D,
         godot::Transform3D,
         Rotation3D,
         Scale3D,
         Velocity3D,
-        godot::PhysicsServer3D>(
+        PhysicsBodySync3D>(
             world,
             "Physics Body 3D Feedback",
-            godot::PhysicsServer3D::BODY_STATE_TRANSFORM,
-            godot::PhysicsServer3D::BODY_STATE_LINEAR_VELOCITY,
-            godot::Variant::TRANSFORM3D,
-            godot::Variant::VECTOR3,
-            [](const godot::Variant& transform_value,
+            [](const godot::Transform3D& physics_transform,
                 Position3D& position,
                 godot::Transform3D& transform_component,
                 Rotation3D* rotation,
                 Scale3D* scale)
     {
-        godot::Transform3D physics_transform = transform_value;
         transform_component = physics_transform;
         position.value = physics_transform.origin;
         if (rotation) { rotation->value = physics_transform.basis.get_euler(); }
         if (scale) { scale->value = physics_transform.basis.get_scale(); }
-    },
-            [](const godot::Variant& velocity_value, Velocity3D& velocity_component)
-    {
-        godot::Vector3 physics_velocity = velocity_value;
-        velocity_component.value = physics_velocity;
     });
 
-    register_physics_cleanup_observer<PhysicsBodyInstance3D, godot::PhysicsServer3D>(
+    register_physics_cleanup_observer<PhysicsBodyInstance3D, PhysicsBodyShapes3D, godot::PhysicsServer3D>(
         world,
         "Physics Body 3D Cleanup");
 });
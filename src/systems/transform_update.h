@@ -1,40 +1,138 @@
 #pragma once
 
-#include <godot_cpp/variant/basis.hpp>
 #include <godot_cpp/variant/transform2d.hpp>
 #include <godot_cpp/variant/transform3d.hpp>
 
+#include "src/components/entity_rendering.h"
 #include "src/components/transform.h"
 #include "src/flecs_registry.h"
+#include "src/utilities/multimesh_packing.h"
+#include "src/utilities/transform_kernels.h"
 
 inline FlecsRegistry register_transform_update_systems([](flecs::world& world)
 {
     // This system updates the Transform2D component for entities that have Position2D, Rotation2D, and Scale2D.
     // Prerequisite: All entities matching this query must already have a godot::Transform2D component.
+    // TranslationOnly2D entities have none, so they don't match and are rendered from their Position2D.
+    // Tables nothing wrote the inputs of since the last update are skipped, so their transforms don't count as changed for the
+    // renderers and the physics sync. Change detection needs the query's own iterator, so the system runs on the main thread.
     world.system<const Position2D, const Rotation2D, const Scale2D, godot::Transform2D>("Transform2D Update")
         .kind(flecs::PreStore)
+        .detect_changes()
         .term_at(4).out() // Mark godot::Transform2D as [out]
-        .each([](const Position2D& position, const Rotation2D& rotation, const Scale2D& scale, godot::Transform2D& transform)
+        .run([](flecs::iter& it)
     {
-        transform.set_origin(position.value);
-        transform.set_rotation_and_scale(rotation.value, scale.value);
+        while (it.next())
+        {
+            if (!it.changed())
+            {
+                it.skip();
+                continue;
+            }
+
+            flecs::field<const Position2D> positions = it.field<const Position2D>(0);
+            flecs::field<const Rotation2D> rotations = it.field<const Rotation2D>(1);
+            flecs::field<const Scale2D> scales = it.field<const Scale2D>(2);
+            flecs::field<godot::Transform2D> transforms = it.field<godot::Transform2D>(3);
+            for (auto i : it)
+            {
+                transforms[i].set_origin(positions[i].value);
+                transforms[i].set_rotation_and_scale(rotations[i].value, scales[i].value);
+            }
+        }
     });
 
     // This system updates the Transform3D component for entities that have Position3D, Rotation3D, and Scale3D.
     // Prerequisite: All entities matching this query must already have a godot::Transform3D component.
+    // A table at a time: compose_transforms_3d() builds the same transforms as Basis(Quaternion::from_euler(rotation), scale)
+    // (the Quaternion avoids the matrix multiplications of Basis::set_euler_scale), four entities per SSE register.
+    // ComposedTransform3D entities have no Transform3D; renderers compose their rows the same way.
+    // Skips unchanged tables like "Transform2D Update".
     world.system<const Position3D, const Rotation3D, const Scale3D, godot::Transform3D>("Transform3D Update")
         .kind(flecs::PreStore)
+        .detect_changes()
         .term_at(4).out() // Mark godot::Transform3D as [out]
-        .each([](const Position3D& position, const Rotation3D& rotation, const Scale3D& scale, godot::Transform3D& transform)
+        .run([](flecs::iter& it)
+    {
+        while (it.next())
+        {
+            if (!it.changed())
+            {
+                it.skip();
+                continue;
+            }
+
+            flecs::field<godot::Transform3D> transforms = it.field<godot::Transform3D>(3);
+            utilities::compose_transforms_3d(utilities::get_transform_components_3d(it), 0, static_cast<uint32_t>(it.count()),
+                reinterpret_cast<float*>(&transforms[0]), 12, utilities::Transform3DLayout::Transform3D);
+        }
+    });
+
+    // These systems capture the transforms at the start of every simulation tick, before any other phase modifies them.
+    // The renderer blends from these snapshots to the current transforms when fixed-timestep interpolation is enabled.
+    world.system<const godot::Transform2D, PreviousTransform2D>("Transform2D Snapshot")
+        .kind(flecs::OnLoad)
+        .multi_threaded()
+        .run([](flecs::iter& it)
+    {
+        const RenderInterpolation* interpolation = it.world().try_get<RenderInterpolation>();
+        if (interpolation == nullptr || !interpolation->enabled)
+        {
+            return;
+        }
+
+        while (it.next())
+        {
+            flecs::field<const godot::Transform2D> transforms = it.field<const godot::Transform2D>(0);
+            flecs::field<PreviousTransform2D> previous_transforms = it.field<PreviousTransform2D>(1);
+            for (auto i : it)
+            {
+                previous_transforms[i].value = transforms[i];
+            }
+        }
+    });
+
+    world.system<const Position2D, PreviousPosition2D>("Position2D Snapshot")
+        .kind(flecs::OnLoad)
+        .multi_threaded()
+        .run([](flecs::iter& it)
     {
-        // The Quaternion approach is more efficient. While Quaternion::from_euler has a cost,
-        // it avoids the multiple matrix multiplications that Basis::set_euler_scale performs internally.
-        transform = {
-            godot::Basis(
-                godot::Quaternion::from_euler(rotation.value),
-                scale.value
-            ),
-            position.value
-        };
+        const RenderInterpolation* interpolation = it.world().try_get<RenderInterpolation>();
+        if (interpolation == nullptr || !interpolation->enabled)
+        {
+            return;
+        }
+
+        while (it.next())
+        {
+            flecs::field<const Position2D> positions = it.field<const Position2D>(0);
+            flecs::field<PreviousPosition2D> previous_positions = it.field<PreviousPosition2D>(1);
+            for (auto i : it)
+            {
+                previous_positions[i].value = positions[i].value;
+            }
+        }
+    });
+
+    world.system<const godot::Transform3D, PreviousTransform3D>("Transform3D Snapshot")
+        .kind(flecs::OnLoad)
+        .multi_threaded()
+        .run([](flecs::iter& it)
+    {
+        const RenderInterpolation* interpolation = it.world().try_get<RenderInterpolation>();
+        if (interpolation == nullptr || !interpolation->enabled)
+        {
+            return;
+        }
+
+        while (it.next())
+        {
+            flecs::field<const godot::Transform3D> transforms = it.field<const godot::Transform3D>(0);
+            flecs::field<PreviousTransform3D> previous_transforms = it.field<PreviousTransform3D>(1);
+            for (auto i : it)
+            {
+                previous_transforms[i].value = transforms[i];
+            }
+        }
     });
 });
@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#include "src/utilities/draw_order_sort.h"
+
+namespace
+{
+    // Insertion sort gives up after this many moves per row and falls back to the radix sort. Low enough that a reshuffled
+    // crowd costs about one extra pass over the rows, high enough that a crowd walking past each other stays on the linear path.
+    constexpr std::size_t INSERTION_SORT_MOVES_PER_ROW = 4;
+    constexpr unsigned int INSERTION_SORT_BACKOFF_FRAMES = 15;
+}
+
+const std::vector<uint32_t>& utilities::DrawOrderSorter::sort(const float* keys, std::size_t count)
+{
+    // Both paths order rows by the same quantised key (ties by row), so switching between them never reorders any rows
+    quantise_keys(keys, count);
+
+    // Any previous order of the same row count is a valid permutation to start from, a different count starts over
+    if (count > 1 && order.size() == count)
+    {
+        if (insertion_backoff_frames > 0)
+        {
+            insertion_backoff_frames--;
+        }
+        else if (insertion_sort(INSERTION_SORT_MOVES_PER_ROW * count + 64))
+        {
+            insertion_sort_count++;
+            return order;
+        }
+        else
+        {
+            // The crowd moves too much relative to its density; don't pay for a failed attempt on every frame
+            insertion_backoff_frames = INSERTION_SORT_BACKOFF_FRAMES;
+        }
+    }
+
+    radix_sort(count);
+    radix_sort_count++;
+    return order;
+}
+
+void utilities::DrawOrderSorter::quantise_keys(const float* keys, std::size_t count)
+{
+    sort_items.resize(count);
+    if (count == 0)
+    {
+        return;
+    }
+
+    float min_key = keys[0];
+    float max_key = keys[0];
+    for (std::size_t row = 1; row < count; ++row)
+    {
+        min_key = std::min(min_key, keys[row]);
+        max_key = std::max(max_key, keys[row]);
+    }
+
+    // 16-bit fixed point over the key range: two 8-bit radix passes. At 100k sprites spread over a few thousand pixels that is
+    // still a fraction of a pixel per step. Items are (key << 32 | row), so rows with equal keys keep their relative order.
+    const float key_range = max_key - min_key;
+    const float scale = key_range > 0.0f && std::isfinite(key_range) ? 65535.0f / key_range : 0.0f;
+    for (std::size_t row = 0; row < count; ++row)
+    {
+        const float scaled = (keys[row] - min_key) * scale;
+        const uint16_t key = scaled >= 0.0f ? static_cast<uint16_t>(std::min(scaled, 65535.0f)) : 0U; // NaN sorts first
+        sort_items[row] = (static_cast<uint64_t>(key) << 32) | static_cast<uint64_t>(row);
+    }
+}
+
+bool utilities::DrawOrderSorter::insertion_sort(std::size_t max_moves)
+{
+    std::size_t moves = 0;
+    for (std::size_t row_idx = 1; row_idx < order.size(); ++row_idx)
+    {
+        const uint32_t row = order[row_idx];
+        const uint64_t item = sort_items[row];
+        std::size_t insert_idx = row_idx;
+        while (insert_idx > 0 && sort_items[order[insert_idx - 1]] > item)
+        {
+            order[insert_idx] = order[insert_idx - 1];
+            insert_idx--;
+        }
+        order[insert_idx] = row;
+
+        moves += row_idx - insert_idx;
+        if (moves > max_moves)
+        {
+            return false; // order is still a valid permutation, the radix sort starts over from the keys
+        }
+    }
+    return true;
+}
+
+void utilities::DrawOrderSorter::radix_sort(std::size_t count)
+{
+    order.resize(count);
+    if (count < 2)
+    {
+        std::iota(order.begin(), order.end(), 0U);
+        return;
+    }
+
+    // Sort the items rather than rows so both passes stream through memory instead of looking keys up by row
+    scratch_items.resize(count);
+    uint32_t bucket_offsets[2][256] = {};
+    for (std::size_t row = 0; row < count; ++row)
+    {
+        const uint64_t key = sort_items[row] >> 32;
+        bucket_offsets[0][key & 0xFFU]++;
+        bucket_offsets[1][key >> 8]++;
+    }
+
+    uint64_t* source = sort_items.data();
+    uint64_t* destination = scratch_items.data();
+    for (unsigned int pass = 0; pass < 2; ++pass)
+    {
+        uint32_t offset = 0;
+        for (uint32_t& bucket_offset : bucket_offsets[pass])
+        {
+            const uint32_t bucket_size = bucket_offset;
+            bucket_offset = offset;
+            offset += bucket_size;
+        }
+
+        const unsigned int shift = 32 + pass * 8;
+        for (std::size_t item_idx = 0; item_idx < count; ++item_idx)
+        {
+            const uint64_t item = source[item_idx];
+            destination[bucket_offsets[pass][(item >> shift) & 0xFFU]++] = item;
+        }
+        std::swap(source, destination);
+    }
+
+    // After an even number of passes the result is back in sort_items
+    for (std::size_t item_idx = 0; item_idx < count; ++item_idx)
+    {
+        order[item_idx] = static_cast<uint32_t>(sort_items[item_idx]);
+    }
+}
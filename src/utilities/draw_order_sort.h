@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace utilities
+{
+    // Sorts MultiMesh rows by a per-row draw order key quantised to 16 bits, as a permutation of row indices. Fixes up the previous
+    // order with an insertion sort when the rows barely moved, otherwise radix sorts.
+    class DrawOrderSorter
+    {
+    public:
+        const std::vector<uint32_t>& sort(const float* keys, std::size_t count);
+
+        std::size_t get_radix_sort_count() const { return radix_sort_count; }
+        std::size_t get_insertion_sort_count() const { return insertion_sort_count; }
+
+    private:
+        std::vector<uint32_t> order;
+        std::vector<uint64_t> sort_items; // quantised key << 32 | row, by row until radix_sort() sorts them
+        std::vector<uint64_t> scratch_items;
+        unsigned int insertion_backoff_frames = 0;
+        std::size_t radix_sort_count = 0;
+        std::size_t insertion_sort_count = 0;
+
+        void quantise_keys(const float* keys, std::size_t count);
+        bool insertion_sort(std::size_t max_moves);
+        void radix_sort(std::size_t count);
+    };
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <godot_cpp/variant/vector2.hpp>
+
+#include <flecs.h>
+
+#include "src/flecs_registry.h"
+
+// All events of one type raised during the current frame, stored column-wise so they can be handed to Godot as packed arrays.
+struct GodotEventBatch {
+    std::string name;
+    std::vector<godot::Vector2> positions;
+    std::vector<int32_t> prefab_indices;
+    std::vector<float> amounts;
+
+    void push(const godot::Vector2& position, int32_t prefab_index, float amount) {
+        positions.push_back(position);
+        prefab_indices.push_back(prefab_index);
+        amounts.push_back(amount);
+    }
+
+    size_t size() const { return positions.size(); }
+
+    void clear() {
+        // Keep the capacity so a busy frame doesn't reallocate on the next one
+        positions.clear();
+        prefab_indices.clear();
+        amounts.clear();
+    }
+};
+
+// Per-frame stream of events from systems to Godot. FlecsWorld flushes it once per frame after progress(), with one call per
+// event type to each callable registered through FlecsWorld::subscribe_events().
+// Prefabs are sent as indices into prefab_names (see FlecsWorld::get_event_prefab_names()) instead of a String per event.
+// Batches are not synchronised, so systems that queue events must not be multi-threaded.
+struct GodotEventQueue {
+    std::deque<GodotEventBatch> batches; // deque keeps references to batches stable when new event types are added
+    std::unordered_map<std::string, size_t> batch_indices;
+    std::vector<std::string> prefab_names;
+    std::unordered_map<flecs::entity_t, int32_t> prefab_indices;
+
+    // Look the batch up once per system run, then push events into it
+    GodotEventBatch& get_batch(const char* event_name) {
+        auto found = batch_indices.find(event_name);
+        if (found != batch_indices.end()) {
+            return batches[found->second];
+        }
+
+        batch_indices.emplace(event_name, batches.size());
+        batches.emplace_back();
+        batches.back().name = event_name;
+        return batches.back();
+    }
+
+    int32_t get_prefab_index(flecs::entity prefab) {
+        auto found = prefab_indices.find(prefab.id());
+        if (found != prefab_indices.end()) {
+            return found->second;
+        }
+
+        const int32_t prefab_index = static_cast<int32_t>(prefab_names.size());
+        prefab_names.push_back(prefab.is_valid() ? prefab.name().c_str() : "");
+        prefab_indices.emplace(prefab.id(), prefab_index);
+        return prefab_index;
+    }
+};
+
+inline FlecsRegistry register_godot_event_queue_component([](flecs::world& world)
+{
+    world.component<GodotEventQueue>("GodotEventQueue")
+        .add(flecs::Singleton);
+    world.set<GodotEventQueue>({});
+});
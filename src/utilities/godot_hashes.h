@@ -5,6 +5,7 @@
 #include <cstdint>
 
 #include <godot_cpp/variant/rid.hpp>
+#include <godot_cpp/variant/string_name.hpp>
 
 namespace std
 {
@@ -16,4 +17,13 @@ namespace std
             return std::hash<int64_t>()(r.get_id());
         }
     };
+
+    template <>
+    struct hash<godot::StringName>
+    {
+        std::size_t operator()(const godot::StringName& s) const noexcept
+        {
+            return static_cast<std::size_t>(s.hash());
+        }
+    };
 }
@@ -15,7 +15,9 @@ inline FlecsRegistry register_godot_signal_component([](flecs::world& world)
     world.component<GodotSignal>("GodotSignal");
 });
 
-// Helper function to emit Godot signals from Flecs systems safely
+// Helper function to emit Godot signals from Flecs systems safely.
+// Emits one flecs_signal_emitted signal per call. For events that can fire many times per frame, queue them on the
+// GodotEventQueue singleton instead (src/utilities/godot_event_queue.h), which delivers them in one batch per frame.
 inline void emit_godot_signal(const flecs::world& world, flecs::entity source_entity, const godot::StringName& name, const godot::Dictionary& data = godot::Dictionary()) {
     GodotSignal signal{ name, data };
     // Defer the emission to ensure it happens at a safe synchronization point (main thread usually)
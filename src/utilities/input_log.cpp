@@ -0,0 +1,321 @@
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "src/utilities/input_log.h"
+
+namespace
+{
+    // "SWIL" + uint32 version, then records of a one byte InputRecordType and its payload, in native byte order. Names are written
+    // once as a Name record and then referred to by a uint16 id.
+    constexpr char LOG_MAGIC[4] = { 'S', 'W', 'I', 'L' };
+    constexpr uint32_t LOG_VERSION = 1;
+    constexpr std::size_t LOG_HEADER_SIZE = sizeof(LOG_MAGIC) + sizeof(LOG_VERSION);
+}
+
+// Writer
+
+utilities::InputLogWriter::~InputLogWriter()
+{
+    close();
+}
+
+bool utilities::InputLogWriter::open(const std::string& path)
+{
+    close();
+
+    file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    // Frames are small; a large buffer turns most of them into a memcpy instead of a write call
+    std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+    write_raw(LOG_MAGIC, sizeof(LOG_MAGIC));
+    write_raw(&LOG_VERSION, sizeof(LOG_VERSION));
+    return true;
+}
+
+void utilities::InputLogWriter::close()
+{
+    if (file != nullptr)
+    {
+        std::fclose(file);
+        file = nullptr;
+    }
+    name_ids.clear();
+}
+
+bool utilities::InputLogWriter::is_open() const
+{
+    return file != nullptr;
+}
+
+void utilities::InputLogWriter::write_progress(double delta)
+{
+    if (file == nullptr) { return; }
+
+    const InputRecordType type = InputRecordType::Progress;
+    write_raw(&type, sizeof(type));
+    write_raw(&delta, sizeof(delta));
+}
+
+void utilities::InputLogWriter::write_singleton(const std::string& name, const uint8_t* data, std::size_t size)
+{
+    write_named_bytes(InputRecordType::SingletonWrite, name, data, size);
+}
+
+void utilities::InputLogWriter::write_run_system(const std::string& name, const uint8_t* data, std::size_t size)
+{
+    write_named_bytes(InputRecordType::RunSystem, name, data, size);
+}
+
+void utilities::InputLogWriter::write_run_system_with_set_parameters(const std::string& name)
+{
+    write_named_bytes(InputRecordType::RunSystemWithSetParameters, name, nullptr, 0);
+}
+
+void utilities::InputLogWriter::write_system_parameters(const std::string& name, const uint8_t* data, std::size_t size)
+{
+    write_named_bytes(InputRecordType::SetSystemParameters, name, data, size);
+}
+
+void utilities::InputLogWriter::write_spawn_batch(const std::string& prefab_name, const uint8_t* data, std::size_t size)
+{
+    write_named_bytes(InputRecordType::SpawnBatch, prefab_name, data, size);
+}
+
+void utilities::InputLogWriter::write_random_seed(int64_t seed)
+{
+    if (file == nullptr) { return; }
+
+    const InputRecordType type = InputRecordType::RandomSeed;
+    write_raw(&type, sizeof(type));
+    write_raw(&seed, sizeof(seed));
+}
+
+uint16_t utilities::InputLogWriter::get_name_id(const std::string& name)
+{
+    auto found = name_ids.find(name);
+    if (found != name_ids.end())
+    {
+        return found->second;
+    }
+
+    const uint16_t name_id = static_cast<uint16_t>(name_ids.size());
+    const uint16_t name_length = static_cast<uint16_t>(std::min<std::size_t>(name.size(), UINT16_MAX));
+    const InputRecordType type = InputRecordType::Name;
+    write_raw(&type, sizeof(type));
+    write_raw(&name_id, sizeof(name_id));
+    write_raw(&name_length, sizeof(name_length));
+    write_raw(name.data(), name_length);
+
+    name_ids.emplace(name, name_id);
+    return name_id;
+}
+
+void utilities::InputLogWriter::write_named_bytes(InputRecordType type, const std::string& name, const uint8_t* data, std::size_t size)
+{
+    if (file == nullptr) { return; }
+
+    const uint16_t name_id = get_name_id(name);
+    const uint32_t data_size = static_cast<uint32_t>(size);
+    write_raw(&type, sizeof(type));
+    write_raw(&name_id, sizeof(name_id));
+    write_raw(&data_size, sizeof(data_size));
+    write_raw(data, size);
+}
+
+void utilities::InputLogWriter::write_raw(const void* data, std::size_t size)
+{
+    if (size > 0)
+    {
+        std::fwrite(data, 1, size, file);
+    }
+}
+
+// Reader
+
+utilities::InputLogReader::~InputLogReader()
+{
+    close();
+}
+
+bool utilities::InputLogReader::open(const std::string& path)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart < static_cast<LONGLONG>(LOG_HEADER_SIZE))
+    {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* view = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (view == nullptr)
+    {
+        if (mapping != nullptr) { CloseHandle(mapping); }
+        CloseHandle(file);
+        return false;
+    }
+    file_handle = file;
+    mapping_handle = mapping;
+    data = static_cast<const uint8_t*>(view);
+    size = static_cast<std::size_t>(file_size.QuadPart);
+#else
+    const int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        return false;
+    }
+    struct stat file_stat;
+    if (fstat(file, &file_stat) != 0 || file_stat.st_size < static_cast<off_t>(LOG_HEADER_SIZE))
+    {
+        ::close(file);
+        return false;
+    }
+    void* view = mmap(nullptr, static_cast<std::size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file); // The mapping keeps its own reference to the file
+    if (view == MAP_FAILED)
+    {
+        return false;
+    }
+    madvise(view, static_cast<std::size_t>(file_stat.st_size), MADV_SEQUENTIAL);
+    data = static_cast<const uint8_t*>(view);
+    size = static_cast<std::size_t>(file_stat.st_size);
+#endif
+
+    uint32_t version = 0;
+    if (std::memcmp(data, LOG_MAGIC, sizeof(LOG_MAGIC)) != 0
+        || (std::memcpy(&version, data + sizeof(LOG_MAGIC), sizeof(version)), version != LOG_VERSION))
+    {
+        close();
+        return false;
+    }
+
+    offset = LOG_HEADER_SIZE;
+    return true;
+}
+
+void utilities::InputLogReader::close()
+{
+    if (data != nullptr)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+        CloseHandle(static_cast<HANDLE>(mapping_handle));
+        CloseHandle(static_cast<HANDLE>(file_handle));
+        mapping_handle = nullptr;
+        file_handle = nullptr;
+#else
+        munmap(const_cast<uint8_t*>(data), size);
+#endif
+    }
+    data = nullptr;
+    size = 0;
+    offset = 0;
+    names.clear();
+}
+
+bool utilities::InputLogReader::is_open() const
+{
+    return data != nullptr;
+}
+
+bool utilities::InputLogReader::next(InputRecord& record)
+{
+    while (data != nullptr)
+    {
+        InputRecordType type;
+        if (!read_raw(&type, sizeof(type)))
+        {
+            return false;
+        }
+
+        record = InputRecord{ type };
+        switch (type)
+        {
+        case InputRecordType::Name:
+        {
+            uint16_t name_id = 0;
+            uint16_t name_length = 0;
+            if (!read_raw(&name_id, sizeof(name_id)) || !read_raw(&name_length, sizeof(name_length)) || offset + name_length > size)
+            {
+                return false;
+            }
+            if (name_id >= names.size())
+            {
+                names.resize(name_id + 1U);
+            }
+            names[name_id].assign(reinterpret_cast<const char*>(data + offset), name_length);
+            offset += name_length;
+            continue;
+        }
+        case InputRecordType::Progress:
+            return read_raw(&record.delta, sizeof(record.delta));
+        case InputRecordType::RandomSeed:
+            return read_raw(&record.seed, sizeof(record.seed));
+        case InputRecordType::SingletonWrite:
+        case InputRecordType::RunSystem:
+        case InputRecordType::RunSystemWithSetParameters:
+        case InputRecordType::SetSystemParameters:
+        case InputRecordType::SpawnBatch:
+        {
+            uint16_t name_id = 0;
+            uint32_t data_size = 0;
+            if (!read_raw(&name_id, sizeof(name_id)) || !read_raw(&data_size, sizeof(data_size))
+                || name_id >= names.size() || offset + data_size > size)
+            {
+                return false;
+            }
+            record.name = &names[name_id];
+            record.data = data + offset;
+            record.size = data_size;
+            offset += data_size;
+            return true;
+        }
+        default:
+            return false; // Unknown record type, the rest of the log can't be parsed
+        }
+    }
+    return false;
+}
+
+bool utilities::InputLogReader::peek_type(InputRecordType& type)
+{
+    const std::size_t record_offset = offset;
+    InputRecord record;
+    const bool has_record = next(record);
+    offset = record_offset; // Name records read on the way are read again, which is harmless
+    type = record.type;
+    return has_record;
+}
+
+bool utilities::InputLogReader::read_raw(void* out, std::size_t count)
+{
+    if (offset + count > size)
+    {
+        return false;
+    }
+    std::memcpy(out, data + offset, count);
+    offset += count;
+    return true;
+}
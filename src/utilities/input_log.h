@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace utilities
+{
+    // Binary log of everything fed into a FlecsWorld from outside (frame deltas, singleton writes, on-demand system runs, batch
+    // spawns, random seeds). Replaying it against a freshly loaded scene reproduces the simulation without GDScript.
+    enum class InputRecordType : uint8_t
+    {
+        Name = 1,                // uint16 id, uint16 length, characters
+        Progress = 2,            // float64 delta
+        SingletonWrite = 3,      // uint16 name id, uint32 size, bytes
+        RunSystem = 4,           // uint16 name id, uint32 size, bytes
+        SetSystemParameters = 5, // uint16 name id, uint32 size, bytes
+        RandomSeed = 6,          // int64 seed
+        SpawnBatch = 7,          // uint16 prefab name id, uint32 size, bytes
+        RunSystemWithSetParameters = 8, // uint16 name id, uint32 size (0)
+    };
+
+    struct InputRecord
+    {
+        InputRecordType type;
+        double delta = 0.0;
+        int64_t seed = 0;
+        const std::string* name = nullptr;
+        const uint8_t* data = nullptr; // Points into the mapped log, valid until the reader is closed
+        std::size_t size = 0;
+    };
+
+    class InputLogWriter
+    {
+    public:
+        ~InputLogWriter();
+
+        bool open(const std::string& path);
+        void close();
+        bool is_open() const;
+
+        void write_progress(double delta);
+        void write_singleton(const std::string& name, const uint8_t* data, std::size_t size);
+        void write_run_system(const std::string& name, const uint8_t* data, std::size_t size);
+        void write_run_system_with_set_parameters(const std::string& name);
+        void write_system_parameters(const std::string& name, const uint8_t* data, std::size_t size);
+        void write_random_seed(int64_t seed);
+        void write_spawn_batch(const std::string& prefab_name, const uint8_t* data, std::size_t size);
+
+    private:
+        std::FILE* file = nullptr;
+        std::unordered_map<std::string, uint16_t> name_ids;
+
+        uint16_t get_name_id(const std::string& name);
+        void write_named_bytes(InputRecordType type, const std::string& name, const uint8_t* data, std::size_t size);
+        void write_raw(const void* data, std::size_t size);
+    };
+
+    // Reads a log written by InputLogWriter from a memory-mapped file.
+    class InputLogReader
+    {
+    public:
+        ~InputLogReader();
+
+        bool open(const std::string& path);
+        void close();
+        bool is_open() const;
+
+        // Returns the next non-Name record, false at the end of the log or on a truncated record
+        bool next(InputRecord& record);
+        // Type of the record next() would return, without consuming it
+        bool peek_type(InputRecordType& type);
+
+    private:
+        const uint8_t* data = nullptr;
+        std::size_t size = 0;
+        std::size_t offset = 0;
+        std::vector<std::string> names;
+#ifdef _WIN32
+        void* file_handle = nullptr;
+        void* mapping_handle = nullptr;
+#endif
+
+        bool read_raw(void* out, std::size_t count);
+    };
+}
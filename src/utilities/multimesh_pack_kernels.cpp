@@ -0,0 +1,293 @@
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MULTIMESH_PACK_SSE2
+#endif
+
+#include "src/utilities/multimesh_pack_kernels.h"
+
+// Buffer format: https://docs.godotengine.org/en/stable/classes/class_renderingserver.html#class-renderingserver-method-multimesh-set-buffer
+// Per instance: the transform in row-major order, then the color (4 floats) and custom data (4 floats) when the MultiMesh uses them.
+// For Transform2D the float order is: (x.x, y.x, padding_float, origin.x, x.y, y.y, padding_float, origin.y).
+// For Transform3D the float order is: (basis.x.x, basis.y.x, basis.z.x, origin.x, basis.x.y, basis.y.y, basis.z.y, origin.y, basis.x.z, basis.y.z, basis.z.z, origin.z).
+//
+// In memory, Transform2D is its three columns (x.x, x.y, y.x, y.y, origin.x, origin.y) and Transform3D its basis rows followed
+// by the origin (rows[0], rows[1], rows[2], origin), so a 3D row is the basis rows interleaved with the origin components.
+// Blending is the component-wise lerp Godot uses for interpolated MultiMesh buffers, done on the raw floats.
+
+namespace
+{
+    constexpr std::size_t POSITION_2D_FLOATS = 2;
+    constexpr std::size_t TRANSFORM_2D_FLOATS = 6;
+    constexpr std::size_t TRANSFORM_3D_FLOATS = 12;
+    constexpr std::size_t ROW_2D_FLOATS = 8;
+    constexpr std::size_t ROW_3D_FLOATS = 12;
+    constexpr std::size_t COLOR_FLOATS = 4;
+
+    template <bool Blend>
+    inline void write_transform_2d(const float* current, const float* previous, float alpha, float* row)
+    {
+#ifdef MULTIMESH_PACK_SSE2
+        __m128 columns = _mm_loadu_ps(current);                                    // x.x, x.y, y.x, y.y
+        __m128 origin = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(current + 4))); // o.x, o.y, 0, 0
+        if constexpr (Blend)
+        {
+            const __m128 weight = _mm_set1_ps(alpha);
+            const __m128 previous_columns = _mm_loadu_ps(previous);
+            const __m128 previous_origin = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(previous + 4)));
+            columns = _mm_add_ps(previous_columns, _mm_mul_ps(_mm_sub_ps(columns, previous_columns), weight));
+            origin = _mm_add_ps(previous_origin, _mm_mul_ps(_mm_sub_ps(origin, previous_origin), weight));
+        }
+        const __m128 by_row = _mm_shuffle_ps(columns, columns, _MM_SHUFFLE(3, 1, 2, 0));  // x.x, y.x, x.y, y.y
+        _mm_storeu_ps(row, _mm_shuffle_ps(by_row, origin, _MM_SHUFFLE(0, 2, 1, 0)));     // x.x, y.x, 0, o.x
+        _mm_storeu_ps(row + 4, _mm_shuffle_ps(by_row, origin, _MM_SHUFFLE(1, 2, 3, 2))); // x.y, y.y, 0, o.y
+#else
+        float blended[TRANSFORM_2D_FLOATS];
+        if constexpr (Blend)
+        {
+            for (std::size_t k = 0; k < TRANSFORM_2D_FLOATS; ++k)
+            {
+                blended[k] = previous[k] + (current[k] - previous[k]) * alpha;
+            }
+            current = blended;
+        }
+        row[0] = current[0];
+        row[1] = current[2];
+        row[2] = 0.0f;
+        row[3] = current[4];
+        row[4] = current[1];
+        row[5] = current[3];
+        row[6] = 0.0f;
+        row[7] = current[5];
+#endif
+    }
+
+    template <bool Blend>
+    inline void write_translation_2d(const float* current, const float* previous, float alpha, float* row)
+    {
+        float x = current[0];
+        float y = current[1];
+        if constexpr (Blend)
+        {
+            x = previous[0] + (x - previous[0]) * alpha;
+            y = previous[1] + (y - previous[1]) * alpha;
+        }
+        row[0] = 1.0f;
+        row[1] = 0.0f;
+        row[2] = 0.0f;
+        row[3] = x;
+        row[4] = 0.0f;
+        row[5] = 1.0f;
+        row[6] = 0.0f;
+        row[7] = y;
+    }
+
+    template <bool Blend>
+    inline void write_transform_3d(const float* current, const float* previous, float alpha, float* row)
+    {
+#ifdef MULTIMESH_PACK_SSE2
+        __m128 a = _mm_loadu_ps(current);     // b.x.x, b.x.y, b.x.z, b.y.x
+        __m128 b = _mm_loadu_ps(current + 4); // b.y.y, b.y.z, b.z.x, b.z.y
+        __m128 c = _mm_loadu_ps(current + 8); // b.z.z, o.x, o.y, o.z
+        if constexpr (Blend)
+        {
+            const __m128 weight = _mm_set1_ps(alpha);
+            const __m128 previous_a = _mm_loadu_ps(previous);
+            const __m128 previous_b = _mm_loadu_ps(previous + 4);
+            const __m128 previous_c = _mm_loadu_ps(previous + 8);
+            a = _mm_add_ps(previous_a, _mm_mul_ps(_mm_sub_ps(a, previous_a), weight));
+            b = _mm_add_ps(previous_b, _mm_mul_ps(_mm_sub_ps(b, previous_b), weight));
+            c = _mm_add_ps(previous_c, _mm_mul_ps(_mm_sub_ps(c, previous_c), weight));
+        }
+        const __m128 x_z_origin = _mm_shuffle_ps(a, c, _MM_SHUFFLE(1, 1, 2, 2));                      // b.x.z, b.x.z, o.x, o.x
+        const __m128 y_x = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 3, 3));                             // b.y.x, b.y.x, b.y.y, b.y.y
+        const __m128 y_z_origin = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 1, 1));                      // b.y.z, b.y.z, o.y, o.y
+        _mm_storeu_ps(row, _mm_shuffle_ps(a, x_z_origin, _MM_SHUFFLE(2, 0, 1, 0)));                   // b.x.x, b.x.y, b.x.z, o.x
+        _mm_storeu_ps(row + 4, _mm_shuffle_ps(y_x, y_z_origin, _MM_SHUFFLE(2, 0, 2, 0)));            // b.y.x, b.y.y, b.y.z, o.y
+        _mm_storeu_ps(row + 8, _mm_shuffle_ps(b, c, _MM_SHUFFLE(3, 0, 3, 2)));                        // b.z.x, b.z.y, b.z.z, o.z
+#else
+        float blended[TRANSFORM_3D_FLOATS];
+        if constexpr (Blend)
+        {
+            for (std::size_t k = 0; k < TRANSFORM_3D_FLOATS; ++k)
+            {
+                blended[k] = previous[k] + (current[k] - previous[k]) * alpha;
+            }
+            current = blended;
+        }
+        row[0] = current[0];
+        row[1] = current[1];
+        row[2] = current[2];
+        row[3] = current[9];
+        row[4] = current[3];
+        row[5] = current[4];
+        row[6] = current[5];
+        row[7] = current[10];
+        row[8] = current[6];
+        row[9] = current[7];
+        row[10] = current[8];
+        row[11] = current[11];
+#endif
+    }
+
+    using utilities::MultiMeshPackSource;
+
+    template <bool Is3D, MultiMeshPackSource Source, bool UseColors, bool UseCustomData, bool Blend, bool Keyed>
+    void pack_rows(const utilities::MultiMeshPackSpan& span, uint32_t begin, uint32_t end, const utilities::MultiMeshPackTarget& target)
+    {
+        static_assert(Source != MultiMeshPackSource::Position2D || !Is3D, "Position spans are 2D");
+        static_assert(Source != MultiMeshPackSource::Components3D || (Is3D && !Blend), "Composed spans are 3D and never blended");
+        constexpr std::size_t transform_floats = Is3D ? TRANSFORM_3D_FLOATS : (Source == MultiMeshPackSource::Position2D ? POSITION_2D_FLOATS : TRANSFORM_2D_FLOATS);
+        constexpr std::size_t transform_row_floats = Is3D ? ROW_3D_FLOATS : ROW_2D_FLOATS;
+        constexpr std::size_t row_floats = transform_row_floats + (UseColors ? COLOR_FLOATS : 0) + (UseCustomData ? COLOR_FLOATS : 0);
+
+        const std::size_t first_row = static_cast<std::size_t>(span.first_row) + begin;
+        float* row = target.rows + first_row * row_floats;
+        float* key = Keyed ? target.sort_keys + first_row : nullptr;
+
+        if constexpr (Source == MultiMeshPackSource::Components3D)
+        {
+            // Composed a few entities at a time, straight into the rows; the loop below adds the rest of each row
+            utilities::compose_transforms_3d(span.components, begin, end, row, row_floats, utilities::Transform3DLayout::MultiMeshRow);
+        }
+
+        for (uint32_t i = begin; i < end; ++i, row += row_floats)
+        {
+            [[maybe_unused]] const float* previous = Blend ? span.previous_transforms + i * transform_floats : nullptr;
+            if constexpr (Source == MultiMeshPackSource::Position2D)
+            {
+                write_translation_2d<Blend>(span.transforms + i * transform_floats, previous, target.interpolation_alpha, row);
+            }
+            else if constexpr (Source == MultiMeshPackSource::Transform && Is3D)
+            {
+                write_transform_3d<Blend>(span.transforms + i * transform_floats, previous, target.interpolation_alpha, row);
+            }
+            else if constexpr (Source == MultiMeshPackSource::Transform)
+            {
+                write_transform_2d<Blend>(span.transforms + i * transform_floats, previous, target.interpolation_alpha, row);
+            }
+
+            std::size_t cursor = transform_row_floats;
+            if constexpr (UseColors)
+            {
+                std::memcpy(row + cursor, span.colors + i * span.color_stride, COLOR_FLOATS * sizeof(float));
+                cursor += COLOR_FLOATS;
+            }
+            if constexpr (UseCustomData)
+            {
+                std::memcpy(row + cursor, span.custom_data + i * span.custom_data_stride, COLOR_FLOATS * sizeof(float));
+            }
+
+            if constexpr (Keyed)
+            {
+                // The origin is the last float of each transform row
+                float row_key = row[3] * target.key_axis[0] + row[7] * target.key_axis[1] + target.key_offset;
+                if constexpr (Is3D)
+                {
+                    row_key += row[11] * target.key_axis[2];
+                }
+                *key++ = row_key;
+            }
+        }
+    }
+
+    template <bool Is3D, MultiMeshPackSource Source, bool UseColors, bool UseCustomData>
+    void pack_rows_of_span(const utilities::MultiMeshPackSpan& span, uint32_t begin, uint32_t end, const utilities::MultiMeshPackTarget& target)
+    {
+        const bool blend = Source != MultiMeshPackSource::Components3D && span.previous_transforms != nullptr;
+        const bool keyed = target.sort_keys != nullptr;
+        if constexpr (Source != MultiMeshPackSource::Components3D)
+        {
+            if (blend)
+            {
+                keyed ? pack_rows<Is3D, Source, UseColors, UseCustomData, true, true>(span, begin, end, target)
+                      : pack_rows<Is3D, Source, UseColors, UseCustomData, true, false>(span, begin, end, target);
+                return;
+            }
+        }
+        keyed ? pack_rows<Is3D, Source, UseColors, UseCustomData, false, true>(span, begin, end, target)
+              : pack_rows<Is3D, Source, UseColors, UseCustomData, false, false>(span, begin, end, target);
+    }
+
+    template <bool Is3D, bool UseColors, bool UseCustomData>
+    void pack_span(const utilities::MultiMeshPackSpan& span, uint32_t begin, uint32_t end, const utilities::MultiMeshPackTarget& target)
+    {
+        if constexpr (Is3D)
+        {
+            if (span.source == MultiMeshPackSource::Components3D)
+            {
+                pack_rows_of_span<true, MultiMeshPackSource::Components3D, UseColors, UseCustomData>(span, begin, end, target);
+                return;
+            }
+        }
+        else
+        {
+            if (span.source == MultiMeshPackSource::Position2D)
+            {
+                pack_rows_of_span<false, MultiMeshPackSource::Position2D, UseColors, UseCustomData>(span, begin, end, target);
+                return;
+            }
+        }
+        pack_rows_of_span<Is3D, MultiMeshPackSource::Transform, UseColors, UseCustomData>(span, begin, end, target);
+    }
+
+    // Indexed by (is_3d << 2) | (use_colors << 1) | use_custom_data
+    constexpr utilities::MultiMeshPackKernel PACK_KERNELS[8] = {
+        &pack_span<false, false, false>,
+        &pack_span<false, false, true>,
+        &pack_span<false, true, false>,
+        &pack_span<false, true, true>,
+        &pack_span<true, false, false>,
+        &pack_span<true, false, true>,
+        &pack_span<true, true, false>,
+        &pack_span<true, true, true>,
+    };
+}
+
+utilities::MultiMeshPackKernel utilities::select_multimesh_pack_kernel(bool is_3d, bool use_colors, bool use_custom_data)
+{
+    return PACK_KERNELS[(is_3d ? 4 : 0) | (use_colors ? 2 : 0) | (use_custom_data ? 1 : 0)];
+}
+
+std::size_t utilities::get_multimesh_row_floats(bool is_3d, bool use_colors, bool use_custom_data)
+{
+    return (is_3d ? ROW_3D_FLOATS : ROW_2D_FLOATS) + (use_colors ? COLOR_FLOATS : 0) + (use_custom_data ? COLOR_FLOATS : 0);
+}
+
+void utilities::pack_spans(MultiMeshPackKernel kernel, const std::vector<MultiMeshPackSpan>& spans, std::size_t row_count, const MultiMeshPackTarget& target, ParallelFor* workers)
+{
+    if (workers == nullptr || workers->get_thread_count() <= 1 || row_count < PARALLEL_PACKING_MIN_ROWS)
+    {
+        for (const MultiMeshPackSpan& span : spans)
+        {
+            kernel(span, 0, span.count, target);
+        }
+        return;
+    }
+
+    // Ranges are in rows, not spans: a few large tables still split evenly. Spans are in ascending row order,
+    // but skipped (unchanged) tables leave gaps between them.
+    workers->run(row_count, PARALLEL_PACKING_MIN_ROWS / 2, [&](std::size_t range_begin, std::size_t range_end) {
+        auto span_it = std::upper_bound(spans.begin(), spans.end(), range_begin, [](std::size_t row, const MultiMeshPackSpan& span) {
+            return row < span.first_row;
+        });
+        if (span_it != spans.begin())
+        {
+            --span_it;
+        }
+
+        for (; span_it != spans.end() && span_it->first_row < range_end; ++span_it)
+        {
+            const std::size_t span_end = static_cast<std::size_t>(span_it->first_row) + span_it->count;
+            if (span_end <= range_begin)
+            {
+                continue;
+            }
+            const uint32_t begin = static_cast<uint32_t>(std::max<std::size_t>(range_begin, span_it->first_row) - span_it->first_row);
+            const uint32_t end = static_cast<uint32_t>(std::min(range_end, span_end) - span_it->first_row);
+            kernel(*span_it, begin, end, target);
+        }
+    });
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "src/utilities/parallel_for.h"
+#include "src/utilities/transform_kernels.h"
+
+namespace utilities
+{
+    // Renderers with fewer rows than this are packed on the calling thread; below it, waking the workers costs more than it saves
+    constexpr std::size_t PARALLEL_PACKING_MIN_ROWS = 2048;
+
+    // What the transform of a span's rows is packed from
+    enum class MultiMeshPackSource : uint8_t
+    {
+        Transform,    // Transform2D or Transform3D columns
+        Position2D,   // Positions (2 floats) of translation-only 2D entities, packed with an identity basis
+        Components3D, // Position, rotation and scale columns of 3D entities, composed straight into the rows
+    };
+
+    // The rows of one table that go into a MultiMesh buffer: column pointers from the query iterator viewed as floats, and the
+    // buffer row of the first entity. Colors and custom data with a stride of 0 are shared by the whole table.
+    struct MultiMeshPackSpan
+    {
+        const float* transforms;
+        const float* previous_transforms; // Previous-tick transforms in the same layout, null unless the rows are blended
+        const float* colors;              // Null unless the renderer uses colors
+        const float* custom_data;         // Null unless the renderer uses custom data
+        uint32_t color_stride;            // In floats: 4, or 0 for a shared column
+        uint32_t custom_data_stride;
+        uint32_t first_row;
+        uint32_t count;
+        MultiMeshPackSource source;
+        Transform3DComponents components; // Components3D only; these rows are never blended
+    };
+
+    // Where a renderer's spans are packed. With sort_keys set, every row also gets a draw order key computed from its
+    // origin as dot(origin, key_axis) + key_offset (the z component is ignored for 2D).
+    struct MultiMeshPackTarget
+    {
+        float* rows;
+        float* sort_keys;
+        float key_axis[3];
+        float key_offset;
+        float interpolation_alpha;
+    };
+
+    // Packs entities [begin, end) of a span into their rows
+    using MultiMeshPackKernel = void (*)(const MultiMeshPackSpan& span, uint32_t begin, uint32_t end, const MultiMeshPackTarget& target);
+
+    // One kernel per buffer layout (2D/3D, with or without colors, with or without custom data), specialised at compile time.
+    // The 2D kernels also handle translation-only spans, the 3D kernels composed ones.
+    MultiMeshPackKernel select_multimesh_pack_kernel(bool is_3d, bool use_colors, bool use_custom_data);
+
+    // Floats per instance in the MultiMesh buffer for a layout
+    std::size_t get_multimesh_row_floats(bool is_3d, bool use_colors, bool use_custom_data);
+
+    // Packs all spans. Every entity's row is fixed by its span's first_row, so splitting the rows over threads gives the same
+    // buffer as packing them in order on one thread. `workers` may be null.
+    void pack_spans(MultiMeshPackKernel kernel, const std::vector<MultiMeshPackSpan>& spans, std::size_t row_count, const MultiMeshPackTarget& target, ParallelFor* workers);
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#include <godot_cpp/variant/transform2d.hpp>
+#include <godot_cpp/variant/transform3d.hpp>
+
+#include <flecs.h>
+
+#include "src/components/entity_rendering.h"
+#include "src/components/transform.h"
+#include "src/utilities/multimesh_pack_kernels.h"
+
+// Glue between the renderer queries and the pack kernels in multimesh_pack_kernels.h, which see the component columns as floats.
+// Uses the godot-cpp math types only, so the benchmark can pack rows without a running engine.
+
+static_assert(std::is_same_v<godot::real_t, float>, "MultiMesh packing expects single-precision math types");
+static_assert(sizeof(godot::Transform2D) == 6 * sizeof(float) && sizeof(PreviousTransform2D) == sizeof(godot::Transform2D));
+static_assert(sizeof(godot::Transform3D) == 12 * sizeof(float) && sizeof(PreviousTransform3D) == sizeof(godot::Transform3D));
+static_assert(sizeof(Position2D) == 2 * sizeof(float) && sizeof(PreviousPosition2D) == sizeof(Position2D));
+static_assert(sizeof(Position3D) == 3 * sizeof(float) && sizeof(Rotation3D) == sizeof(Position3D) && sizeof(Scale3D) == sizeof(Position3D));
+static_assert(sizeof(RenderingColor) == 4 * sizeof(float) && sizeof(RenderingCustomData) == 4 * sizeof(float));
+
+namespace utilities
+{
+    // TransformType is godot::Transform2D or godot::Transform3D, or the type of field 0 of the queries that render entities from
+    // their components: Position2D for TranslationOnly2D entities, Position3D for ComposedTransform3D ones
+    template <typename TransformType>
+    using PreviousTransformFor = std::conditional_t<std::is_same_v<TransformType, godot::Transform2D>, PreviousTransform2D,
+        std::conditional_t<std::is_same_v<TransformType, Position2D>, PreviousPosition2D, PreviousTransform3D>>;
+
+    template <typename TransformType>
+    using TransformComponentsFor = std::conditional_t<std::is_same_v<TransformType, godot::Transform2D>, Position2D, Position3D>;
+
+    // Position3D, Rotation3D and Scale3D in fields 0 to 2, as the input of compose_transforms_3d()
+    inline Transform3DComponents get_transform_components_3d(flecs::iter& it)
+    {
+        Transform3DComponents components{};
+        components.positions = reinterpret_cast<const float*>(&it.field<const Position3D>(0)[0]);
+        components.rotations = reinterpret_cast<const float*>(&it.field<const Rotation3D>(1)[0]);
+        components.scales = reinterpret_cast<const float*>(&it.field<const Scale3D>(2)[0]);
+        components.position_stride = it.is_self(0) ? 3U : 0U;
+        components.rotation_stride = it.is_self(1) ? 3U : 0U;
+        components.scale_stride = it.is_self(2) ? 3U : 0U;
+        return components;
+    }
+
+    // Builds the span for the table the iterator is on, fetching each column once. Fields follow the renderer queries: 0 is the
+    // transform (or position), 1 the optional previous-tick one, then the color and custom data when the renderer uses them.
+    // Composed 3D queries have the Position3D, Rotation3D and Scale3D in fields 0 to 2 instead, and are never blended.
+    template <typename TransformType>
+    MultiMeshPackSpan make_pack_span(flecs::iter& it, bool interpolate, bool use_colors, bool use_custom_data, uint32_t first_row, uint32_t count)
+    {
+        MultiMeshPackSpan span{};
+        int8_t next_field_idx = 2;
+        if constexpr (std::is_same_v<TransformType, Position3D>)
+        {
+            span.source = MultiMeshPackSource::Components3D;
+            span.components = get_transform_components_3d(it);
+            next_field_idx = 3;
+        }
+        else
+        {
+            span.source = std::is_same_v<TransformType, Position2D> ? MultiMeshPackSource::Position2D : MultiMeshPackSource::Transform;
+            span.transforms = reinterpret_cast<const float*>(&it.field<const TransformType>(0)[0]);
+            if (interpolate && it.is_set(1))
+            {
+                span.previous_transforms = reinterpret_cast<const float*>(&it.field<const PreviousTransformFor<TransformType>>(1)[0]);
+            }
+        }
+
+        if (use_colors)
+        {
+            span.color_stride = it.is_self(next_field_idx) ? 4U : 0U;
+            span.colors = reinterpret_cast<const float*>(&it.field<const RenderingColor>(next_field_idx++)[0]);
+        }
+        if (use_custom_data)
+        {
+            span.custom_data_stride = it.is_self(next_field_idx) ? 4U : 0U;
+            span.custom_data = reinterpret_cast<const float*>(&it.field<const RenderingCustomData>(next_field_idx++)[0]);
+        }
+
+        span.first_row = first_row;
+        span.count = count;
+        return span;
+    }
+
+    // Origin of a 2D instance, for code that handles both kinds of 2D renderer queries
+    inline const godot::Vector2& get_instance_origin(const godot::Transform2D& transform) { return transform.columns[2]; }
+    inline const godot::Vector2& get_instance_origin(const Position2D& position) { return position.value; }
+
+    // Sets up the draw order key of a pack target: an origin axis, or (negated, so that the ascending sort draws far
+    // instances first) the depth along the camera's view direction.
+    inline void set_draw_order_key(MultiMeshPackTarget& target, DrawOrder draw_order, const DrawOrderCamera* camera)
+    {
+        target.key_axis[0] = draw_order == DrawOrder::X ? 1.0f : 0.0f;
+        target.key_axis[1] = draw_order == DrawOrder::Y ? 1.0f : 0.0f;
+        target.key_axis[2] = draw_order == DrawOrder::Z ? 1.0f : 0.0f;
+        target.key_offset = 0.0f;
+        if (draw_order == DrawOrder::CameraDepth && camera != nullptr)
+        {
+            target.key_axis[0] = -camera->forward.x;
+            target.key_axis[1] = -camera->forward.y;
+            target.key_axis[2] = -camera->forward.z;
+            target.key_offset = camera->forward.dot(camera->position);
+        }
+    }
+}
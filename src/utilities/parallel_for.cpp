@@ -0,0 +1,104 @@
+#include <algorithm>
+
+#include "src/utilities/parallel_for.h"
+
+utilities::ParallelFor::ParallelFor(unsigned int thread_count)
+{
+    const unsigned int worker_count = thread_count > 1 ? thread_count - 1 : 0;
+    workers.reserve(worker_count);
+    for (unsigned int worker_idx = 0; worker_idx < worker_count; ++worker_idx)
+    {
+        workers.emplace_back(&ParallelFor::worker_loop, this);
+    }
+}
+
+utilities::ParallelFor::~ParallelFor()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_ready.notify_all();
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+unsigned int utilities::ParallelFor::get_thread_count() const
+{
+    return static_cast<unsigned int>(workers.size()) + 1U;
+}
+
+void utilities::ParallelFor::run(std::size_t count, std::size_t min_range_size, const std::function<void(std::size_t, std::size_t)>& function)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    const std::size_t max_ranges = (count + std::max<std::size_t>(min_range_size, 1) - 1) / std::max<std::size_t>(min_range_size, 1);
+    const std::size_t ranges = std::min<std::size_t>(get_thread_count(), max_ranges);
+    if (ranges <= 1)
+    {
+        function(0, count);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &function;
+        job_count = count;
+        range_size = (count + ranges - 1) / ranges;
+        range_count = (count + range_size - 1) / range_size;
+        next_range.store(0, std::memory_order_relaxed);
+        pending_workers = static_cast<unsigned int>(workers.size());
+        generation++;
+    }
+    work_ready.notify_all();
+
+    run_ranges();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    work_done.wait(lock, [this] { return pending_workers == 0; });
+    job = nullptr;
+}
+
+void utilities::ParallelFor::worker_loop()
+{
+    uint64_t seen_generation = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            work_ready.wait(lock, [&] { return stopping || generation != seen_generation; });
+            if (stopping)
+            {
+                return;
+            }
+            seen_generation = generation;
+        }
+
+        run_ranges();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending_workers--;
+        }
+        work_done.notify_one();
+    }
+}
+
+void utilities::ParallelFor::run_ranges()
+{
+    while (true)
+    {
+        const std::size_t range_idx = next_range.fetch_add(1, std::memory_order_relaxed);
+        if (range_idx >= range_count)
+        {
+            return;
+        }
+        const std::size_t begin = range_idx * range_size;
+        (*job)(begin, std::min(begin + range_size, job_count));
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utilities
+{
+    // Persistent worker threads that split a loop into contiguous index ranges, for work outside Flecs' own scheduling.
+    // The calling thread works on the ranges too. run() is not reentrant and must only be called from one thread at a time.
+    class ParallelFor
+    {
+    public:
+        // thread_count includes the calling thread, so thread_count - 1 workers are started
+        explicit ParallelFor(unsigned int thread_count);
+        ~ParallelFor();
+
+        ParallelFor(const ParallelFor&) = delete;
+        ParallelFor& operator=(const ParallelFor&) = delete;
+
+        unsigned int get_thread_count() const;
+
+        // Calls function(begin, end) for disjoint ranges covering [0, count), at most one range per thread and none shorter
+        // than min_range_size (except the last). Runs inline when that leaves a single range.
+        void run(std::size_t count, std::size_t min_range_size, const std::function<void(std::size_t, std::size_t)>& function);
+
+    private:
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable work_ready;
+        std::condition_variable work_done;
+        uint64_t generation = 0;
+        unsigned int pending_workers = 0;
+        bool stopping = false;
+
+        const std::function<void(std::size_t, std::size_t)>* job = nullptr;
+        std::size_t job_count = 0;
+        std::size_t range_size = 0;
+        std::size_t range_count = 0;
+        std::atomic<std::size_t> next_range{ 0 };
+
+        void worker_loop();
+        void run_ranges();
+    };
+}
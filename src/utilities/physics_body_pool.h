@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <godot_cpp/classes/physics_server2d.hpp>
+#include <godot_cpp/classes/physics_server3d.hpp>
+#include <godot_cpp/variant/callable.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/rid.hpp>
+#include <godot_cpp/variant/variant.hpp>
+#include <godot_cpp/variant/vector2.hpp>
+#include <godot_cpp/variant/vector3.hpp>
+
+#include <flecs.h>
+
+#include "src/flecs_registry.h"
+#include "src/flecs_singleton_registry.h"
+
+// Caps the bodies PhysicsBodyPool2D/3D keeps parked for the instances of one prefab, instead of the pool's default_max_parked.
+// Set it on the prefab, e.g. `PhysicsBodyPoolSize: {max_parked: 2048}` in a Flecs script. 0 turns pooling off for the prefab.
+struct PhysicsBodyPoolSize
+{
+    int32_t max_parked;
+};
+
+// Bodies of removed prefab instances, kept per prefab for the next instances of the same prefab. Parked bodies are taken out of
+// their space and keep their mode, shapes, layer and mask, so reusing one only puts it back in the space. Instances that own
+// their shapes instead of inheriting them aren't pooled. Hits and misses count the spawns of pooled prefabs that did or didn't
+// find a parked body; read them with get_singleton_component("PhysicsBodyPool2D").
+template<typename ServerT>
+struct PhysicsBodyPool
+{
+    using LinearVelocity = std::conditional_t<std::is_same_v<ServerT, godot::PhysicsServer2D>, godot::Vector2, godot::Vector3>;
+    using AngularVelocity = std::conditional_t<std::is_same_v<ServerT, godot::PhysicsServer2D>, godot::real_t, godot::Vector3>;
+
+    std::unordered_map<flecs::entity_t, std::vector<godot::RID>> parked_bodies; // By prefab
+    int32_t default_max_parked = 256;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    // A parked body of the prefab, back in the space, or an invalid RID when there is none
+    godot::RID unpark(ServerT* physics_server, flecs::entity_t prefab, const godot::RID& space_rid)
+    {
+        if (prefab == 0) { return godot::RID(); }
+
+        auto found = parked_bodies.find(prefab);
+        if (found == parked_bodies.end() || found->second.empty())
+        {
+            misses++;
+            return godot::RID();
+        }
+
+        godot::RID body_rid = found->second.back();
+        found->second.pop_back();
+        physics_server->body_set_space(body_rid, space_rid);
+        hits++;
+        return body_rid;
+    }
+
+    // Takes the body out of its space and keeps it for the next instance of the prefab. Returns false when the prefab's bodies
+    // aren't pooled or its pool is full, the caller frees the body then.
+    bool park(ServerT* physics_server, flecs::entity_t prefab, const godot::RID& body_rid, const PhysicsBodyPoolSize* pool_size)
+    {
+        if (prefab == 0) { return false; }
+
+        const int32_t max_parked = pool_size ? pool_size->max_parked : default_max_parked;
+        std::vector<godot::RID>& bodies = parked_bodies[prefab];
+        if (static_cast<int64_t>(bodies.size()) >= max_parked) { return false; }
+
+        physics_server->body_set_space(body_rid, godot::RID());
+        physics_server->body_set_state_sync_callback(body_rid, godot::Callable());
+        physics_server->body_set_state(body_rid, ServerT::BODY_STATE_LINEAR_VELOCITY, LinearVelocity());
+        physics_server->body_set_state(body_rid, ServerT::BODY_STATE_ANGULAR_VELOCITY, AngularVelocity());
+        bodies.push_back(body_rid);
+        return true;
+    }
+
+    void free_parked_bodies()
+    {
+        ServerT* physics_server = ServerT::get_singleton();
+        for (auto& [prefab, bodies] : parked_bodies)
+        {
+            if (physics_server)
+            {
+                for (const godot::RID& body_rid : bodies) { physics_server->free_rid(body_rid); }
+            }
+            bodies.clear();
+        }
+    }
+
+    operator godot::Variant() const
+    {
+        int64_t parked_count = 0;
+        for (const auto& [prefab, bodies] : parked_bodies) { parked_count += static_cast<int64_t>(bodies.size()); }
+
+        godot::Dictionary stats;
+        stats["hits"] = static_cast<int64_t>(hits);
+        stats["misses"] = static_cast<int64_t>(misses);
+        stats["parked"] = parked_count;
+        stats["default_max_parked"] = default_max_parked;
+        return stats;
+    }
+};
+
+using PhysicsBodyPool2D = PhysicsBodyPool<godot::PhysicsServer2D>;
+using PhysicsBodyPool3D = PhysicsBodyPool<godot::PhysicsServer3D>;
+
+// The prefab whose parked bodies an instance can reuse: the one it inherits its shapes from. 0 when the instance owns its shapes.
+template<typename ShapesT>
+inline flecs::entity_t get_physics_body_prefab(flecs::entity entity)
+{
+    if (entity.template owns<ShapesT>()) { return 0; }
+    return entity.target(flecs::IsA).id();
+}
+
+namespace
+{
+    template<typename PoolT>
+    inline void register_physics_body_pool(flecs::world& world, const char* name)
+    {
+        world.component<PoolT>(name)
+            .add(flecs::Singleton)
+            .on_remove([](PoolT& body_pool) { body_pool.free_parked_bodies(); });
+        world.set<PoolT>({});
+
+        register_singleton_getter<PoolT>(name);
+        register_singleton_setter<godot::Dictionary>(name, [](flecs::world& world, const godot::Dictionary& pool_settings) {
+            PoolT* body_pool = world.try_get_mut<PoolT>();
+            if (!body_pool) { return; }
+
+            if (pool_settings.has("default_max_parked")) {
+                body_pool->default_max_parked = static_cast<int32_t>(pool_settings.get("default_max_parked", body_pool->default_max_parked));
+            }
+        });
+    }
+}
+
+inline FlecsRegistry register_physics_body_pools([](flecs::world& world)
+{
+    world.component<PhysicsBodyPoolSize>("PhysicsBodyPoolSize")
+        .member<int32_t>("max_parked");
+
+    register_physics_body_pool<PhysicsBodyPool2D>(world, "PhysicsBodyPool2D");
+    register_physics_body_pool<PhysicsBodyPool3D>(world, "PhysicsBodyPool3D");
+});
@@ -1,8 +1,20 @@
 #include <algorithm>
+#include <cstdint>
 #include <thread>
 
+#include <godot_cpp/classes/os.hpp>
+#include <godot_cpp/classes/project_settings.hpp>
+#include <godot_cpp/core/property_info.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+
 #include "src/utilities/platform.h"
 
+namespace
+{
+    const char* const THREAD_COUNT_SETTING = "flecs/threading/thread_count";
+    constexpr int64_t MAX_THREAD_COUNT = 64;
+}
+
 unsigned int utilities::Platform::get_thread_count()
 {
     unsigned int num_hardware_threads = std::thread::hardware_concurrency();
@@ -12,3 +24,51 @@ unsigned int utilities::Platform::get_thread_count()
             num_hardware_threads > 1 ? num_hardware_threads - 1 : 1U));
     return num_threads;
 }
+
+unsigned int utilities::Platform::get_configured_thread_count()
+{
+    int64_t configured_thread_count = 0;
+    godot::ProjectSettings* project_settings = godot::ProjectSettings::get_singleton();
+    if (project_settings && project_settings->has_setting(THREAD_COUNT_SETTING))
+    {
+        // get_setting_with_override() honours feature tag overrides such as "thread_count.web"
+        configured_thread_count = project_settings->get_setting_with_override(THREAD_COUNT_SETTING);
+    }
+
+    if (configured_thread_count > 0)
+    {
+        return static_cast<unsigned int>(std::min(configured_thread_count, MAX_THREAD_COUNT));
+    }
+
+    // Web exports get a small, fixed pthread pool (and none at all with the no-threads templates).
+    // Spawning Flecs workers there exhausts the pool, so automatic mode stays on the main thread.
+    godot::OS* os = godot::OS::get_singleton();
+    if (os && os->has_feature("web"))
+    {
+        return 1U;
+    }
+
+    return get_thread_count();
+}
+
+void utilities::Platform::register_project_settings()
+{
+    godot::ProjectSettings* project_settings = godot::ProjectSettings::get_singleton();
+    if (!project_settings)
+    {
+        return;
+    }
+
+    if (!project_settings->has_setting(THREAD_COUNT_SETTING))
+    {
+        project_settings->set_setting(THREAD_COUNT_SETTING, 0);
+    }
+    project_settings->set_initial_value(THREAD_COUNT_SETTING, 0);
+
+    godot::Dictionary property_info;
+    property_info["name"] = THREAD_COUNT_SETTING;
+    property_info["type"] = godot::Variant::INT;
+    property_info["hint"] = godot::PROPERTY_HINT_RANGE;
+    property_info["hint_string"] = "0,64,1";
+    project_settings->add_property_info(property_info);
+}
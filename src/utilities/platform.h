@@ -6,5 +6,10 @@ namespace utilities
     {
     public:
         static unsigned int get_thread_count();
+
+        // Thread count for the Flecs worker pool, resolved from the "flecs/threading/thread_count" project setting.
+        // A value of 0 means automatic: the hardware thread count on desktop and a single thread on the web export.
+        static unsigned int get_configured_thread_count();
+        static void register_project_settings();
     };
 }
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <godot_cpp/variant/transform2d.hpp>
+#include <godot_cpp/variant/utility_functions.hpp>
+#include <godot_cpp/variant/vector2.hpp>
+
+#include <flecs.h>
+
+#include "src/components/entity_rendering.h"
+#include "src/components/transform.h"
+
+static_assert(sizeof(Position2D) == sizeof(godot::Vector2) && sizeof(PreviousPosition2D) == sizeof(godot::Vector2));
+static_assert(sizeof(Rotation2D) == sizeof(godot::real_t) && sizeof(Scale2D) == sizeof(godot::Vector2));
+
+// Spawns `count` instances of a 2D prefab in one structural change: ecs_bulk_init() appends all of them to their table at once,
+// with their Position2D (and, unless the prefab is TranslationOnly2D, Rotation2D, Scale2D and transform) columns written
+// directly. rotations and scales may be null, the instances keep the prefab's then. Positions go in as they are, Vector2 and the
+// position components have the same layout. The world must not be in readonly mode: call it from outside progress(), or from
+// an immediate() system. Returns the number of instances spawned.
+inline int32_t spawn_prefab_batch_2d(
+    flecs::world& world,
+    flecs::entity prefab,
+    const godot::Vector2* positions,
+    const godot::real_t* rotations,
+    const godot::Vector2* scales,
+    int32_t count)
+{
+    if (count <= 0 || !prefab) { return 0; }
+    if (prefab.has<Position3D>())
+    {
+        godot::UtilityFunctions::push_warning(godot::String("spawn_prefab_batch_2d only spawns 2D prefabs, '") + prefab.name().c_str() + "' is 3D.");
+        return 0;
+    }
+
+    // The columns of all instances, in the order of desc.ids
+    ecs_bulk_desc_t desc = {};
+    void* columns[FLECS_ID_DESC_MAX] = {};
+    int32_t id_count = 0;
+    auto add_column = [&](ecs_id_t id, const void* column)
+    {
+        desc.ids[id_count] = id;
+        columns[id_count++] = const_cast<void*>(column);
+    };
+
+    add_column(ecs_pair(flecs::IsA, prefab), nullptr);
+    add_column(world.id<Position2D>(), positions);
+
+    std::vector<Rotation2D> rotation_column;
+    std::vector<Scale2D> scale_column;
+    std::vector<godot::Transform2D> transform_column;
+    if (prefab.has<TranslationOnly2D>())
+    {
+        add_column(world.id<PreviousPosition2D>(), positions);
+    }
+    else
+    {
+        const Rotation2D* prefab_rotation = prefab.try_get<Rotation2D>();
+        const Scale2D* prefab_scale = prefab.try_get<Scale2D>();
+        const godot::real_t default_rotation = prefab_rotation ? prefab_rotation->value : 0.0f;
+        const godot::Vector2 default_scale = prefab_scale ? prefab_scale->value : godot::Vector2(1.0f, 1.0f);
+
+        rotation_column.resize(count);
+        scale_column.resize(count);
+        transform_column.resize(count);
+        for (int32_t i = 0; i < count; ++i)
+        {
+            rotation_column[i].value = rotations ? rotations[i] : default_rotation;
+            scale_column[i].value = scales ? scales[i] : default_scale;
+            transform_column[i] = godot::Transform2D(rotation_column[i].value, scale_column[i].value, 0.0f, positions[i]);
+        }
+
+        add_column(world.id<Rotation2D>(), rotation_column.data());
+        add_column(world.id<Scale2D>(), scale_column.data());
+        add_column(world.id<godot::Transform2D>(), transform_column.data());
+        add_column(world.id<PreviousTransform2D>(), transform_column.data()); // Don't interpolate from the prefab's default transform
+    }
+
+    desc.count = count;
+    desc.data = columns;
+    ecs_bulk_init(world.c_ptr(), &desc);
+    return count;
+}
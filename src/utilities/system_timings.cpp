@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cmath>
+
+#include "src/utilities/system_timings.h"
+
+// Frame times are differences of each system's growing time_spent total, which a float total would round away within minutes
+static_assert(sizeof(ecs_ftime_t) == sizeof(double), "SystemTimings needs Flecs built with ecs_ftime_t=double");
+
+utilities::SystemTimings::SystemTimings(std::size_t frame_capacity) : frame_capacity(std::max<std::size_t>(frame_capacity, 1U))
+{
+}
+
+void utilities::SystemTimings::track_systems(flecs::world& world)
+{
+    world.measure_time(true);
+
+    systems.clear();
+    write_index = 0;
+    frame_count = 0;
+
+    flecs::query<> system_query = world.query_builder()
+        .with(flecs::System)
+        .build();
+
+    system_query.each([this](flecs::entity system_entity) {
+        const ecs_system_t* system_data = ecs_system_get(system_entity.world().c_ptr(), system_entity.id());
+        TrackedSystem tracked_system{
+            system_entity.id(),
+            system_entity.name().c_str(),
+            system_data != nullptr ? static_cast<double>(system_data->time_spent) : 0.0,
+            std::vector<float>(frame_capacity, 0.0f)
+        };
+        systems.push_back(std::move(tracked_system));
+    });
+
+    system_query.destruct();
+}
+
+void utilities::SystemTimings::sample_frame(const flecs::world& world)
+{
+    if (systems.empty())
+    {
+        return;
+    }
+
+    for (TrackedSystem& tracked_system : systems)
+    {
+        const ecs_system_t* system_data = ecs_system_get(world.c_ptr(), tracked_system.entity);
+        if (system_data == nullptr)
+        {
+            tracked_system.frame_usec[write_index] = 0.0f;
+            continue;
+        }
+
+        const double time_spent_sec = static_cast<double>(system_data->time_spent);
+        const double frame_time_sec = std::max(time_spent_sec - tracked_system.last_time_spent_sec, 0.0);
+        tracked_system.frame_usec[write_index] = static_cast<float>(frame_time_sec * 1000000.0);
+        tracked_system.last_time_spent_sec = time_spent_sec;
+    }
+
+    write_index = (write_index + 1) % frame_capacity;
+    frame_count = std::min(frame_count + 1, frame_capacity);
+}
+
+std::size_t utilities::SystemTimings::get_system_count() const
+{
+    return systems.size();
+}
+
+const std::string& utilities::SystemTimings::get_system_name(std::size_t system_index) const
+{
+    return systems[system_index].name;
+}
+
+double utilities::SystemTimings::get_last_frame_usec(std::size_t system_index) const
+{
+    if (system_index >= systems.size() || frame_count == 0)
+    {
+        return 0.0;
+    }
+
+    const std::size_t last_index = (write_index + frame_capacity - 1) % frame_capacity;
+    return static_cast<double>(systems[system_index].frame_usec[last_index]);
+}
+
+std::vector<utilities::SystemTimingSummary> utilities::SystemTimings::summarize() const
+{
+    std::vector<SystemTimingSummary> summaries;
+    summaries.reserve(systems.size());
+
+    std::vector<float> sorted_samples;
+    sorted_samples.reserve(frame_capacity);
+
+    for (const TrackedSystem& tracked_system : systems)
+    {
+        SystemTimingSummary summary{ tracked_system.name, 0.0, 0.0, 0.0, 0.0 };
+        if (frame_count > 0)
+        {
+            // Before the ring buffer wraps, only the first frame_count slots hold samples
+            sorted_samples.assign(tracked_system.frame_usec.begin(), tracked_system.frame_usec.begin() + static_cast<std::ptrdiff_t>(frame_count));
+            std::sort(sorted_samples.begin(), sorted_samples.end());
+
+            double total_usec = 0.0;
+            for (float sample : sorted_samples)
+            {
+                total_usec += static_cast<double>(sample);
+            }
+
+            const std::size_t p99_index = static_cast<std::size_t>(std::ceil(0.99 * static_cast<double>(frame_count))) - 1U;
+            summary.min_usec = static_cast<double>(sorted_samples.front());
+            summary.mean_usec = total_usec / static_cast<double>(frame_count);
+            summary.p99_usec = static_cast<double>(sorted_samples[std::min(p99_index, frame_count - 1U)]);
+            summary.max_usec = static_cast<double>(sorted_samples.back());
+        }
+        summaries.push_back(summary);
+    }
+
+    return summaries;
+}
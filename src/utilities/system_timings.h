@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <flecs.h>
+
+namespace utilities
+{
+    struct SystemTimingSummary
+    {
+        std::string name;
+        double min_usec;
+        double mean_usec;
+        double p99_usec;
+        double max_usec;
+    };
+
+    // Per-system timings of the last frame_capacity frames, from the time Flecs already measures for every system run
+    class SystemTimings
+    {
+    public:
+        explicit SystemTimings(std::size_t frame_capacity = 120);
+
+        // Enables time measurement and starts tracking every system currently registered in the world.
+        void track_systems(flecs::world& world);
+
+        // Records the time each tracked system spent since the previous call. Call once per frame.
+        void sample_frame(const flecs::world& world);
+
+        std::size_t get_system_count() const;
+        const std::string& get_system_name(std::size_t system_index) const;
+        double get_last_frame_usec(std::size_t system_index) const;
+
+        std::vector<SystemTimingSummary> summarize() const;
+
+    private:
+        struct TrackedSystem
+        {
+            flecs::entity_t entity;
+            std::string name;
+            double last_time_spent_sec;
+            std::vector<float> frame_usec;
+        };
+
+        std::vector<TrackedSystem> systems;
+        std::size_t frame_capacity;
+        std::size_t write_index = 0;
+        std::size_t frame_count = 0;
+    };
+}
@@ -0,0 +1,212 @@
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRANSFORM_KERNELS_SSE2
+#endif
+
+#include "src/utilities/transform_kernels.h"
+
+// The composition follows godot-cpp: Quaternion::from_euler() for the YXZ Euler order, then Basis(quaternion, scale), which is
+// the rotation matrix with its columns multiplied by the scale. Both paths compute the 12 values of a transform in the order
+// basis rows (row-major), origin, and LAYOUT_ORDER picks them for the output layout.
+
+namespace
+{
+    constexpr std::size_t TRANSFORM_3D_FLOATS = 12;
+
+    constexpr int LAYOUT_ORDER[2][TRANSFORM_3D_FLOATS] = {
+        { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 }, // Transform3DLayout::Transform3D
+        { 0, 1, 2, 9, 3, 4, 5, 10, 6, 7, 8, 11 }, // Transform3DLayout::MultiMeshRow
+    };
+
+#ifdef TRANSFORM_KERNELS_SSE2
+    inline __m128 select(__m128 mask, __m128 if_set, __m128 if_clear)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, if_set), _mm_andnot_ps(mask, if_clear));
+    }
+
+    // sin and cos of four angles: reduced to [-pi/4, pi/4] around the nearest multiple of pi/2 (Cody-Waite, three parts), then
+    // the Cephes single precision polynomials, swapped and negated by quadrant. Accurate to a few ulp for the angle ranges
+    // entities rotate through.
+    inline void sincos4(__m128 angles, __m128& sin_out, __m128& cos_out)
+    {
+        const __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(angles, _mm_set1_ps(0.636619772367581343f))); // Rounded angle / (pi/2)
+        const __m128 quadrant_f = _mm_cvtepi32_ps(quadrant);
+        __m128 r = _mm_sub_ps(angles, _mm_mul_ps(quadrant_f, _mm_set1_ps(1.5703125f)));
+        r = _mm_sub_ps(r, _mm_mul_ps(quadrant_f, _mm_set1_ps(4.837512969970703125e-4f)));
+        r = _mm_sub_ps(r, _mm_mul_ps(quadrant_f, _mm_set1_ps(7.54978995489188216e-8f)));
+        const __m128 r2 = _mm_mul_ps(r, r);
+
+        __m128 sin_poly = _mm_set1_ps(-1.9515295891e-4f);
+        sin_poly = _mm_add_ps(_mm_mul_ps(sin_poly, r2), _mm_set1_ps(8.3321608736e-3f));
+        sin_poly = _mm_add_ps(_mm_mul_ps(sin_poly, r2), _mm_set1_ps(-1.6666654611e-1f));
+        const __m128 sin_r = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), sin_poly));
+
+        __m128 cos_poly = _mm_set1_ps(2.443315711809948e-5f);
+        cos_poly = _mm_add_ps(_mm_mul_ps(cos_poly, r2), _mm_set1_ps(-1.388731625493765e-3f));
+        cos_poly = _mm_add_ps(_mm_mul_ps(cos_poly, r2), _mm_set1_ps(4.166664568298827e-2f));
+        const __m128 cos_r = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(r2, _mm_set1_ps(0.5f))), _mm_mul_ps(_mm_mul_ps(r2, r2), cos_poly));
+
+        // Odd quadrants swap sin and cos; sin is negated in quadrants 2 and 3, cos in quadrants 1 and 2
+        const __m128i one = _mm_set1_epi32(1);
+        const __m128i two = _mm_set1_epi32(2);
+        const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one));
+        const __m128 sin_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, two), 30));
+        const __m128 cos_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, one), two), 30));
+        sin_out = _mm_xor_ps(select(swap, cos_r, sin_r), sin_sign);
+        cos_out = _mm_xor_ps(select(swap, sin_r, cos_r), cos_sign);
+    }
+
+    // Loads the x, y and z of four entities (the last one repeated when fewer are left) into one register each
+    inline void gather_xyz(const float* column, uint32_t stride, const uint32_t (&entities)[4], __m128 (&xyz)[3])
+    {
+        const float* e0 = column + entities[0] * stride;
+        const float* e1 = column + entities[1] * stride;
+        const float* e2 = column + entities[2] * stride;
+        const float* e3 = column + entities[3] * stride;
+        for (int component = 0; component < 3; ++component)
+        {
+            xyz[component] = _mm_setr_ps(e0[component], e1[component], e2[component], e3[component]);
+        }
+    }
+
+    void compose_four(const utilities::Transform3DComponents& components, uint32_t first, uint32_t lanes, float* out, std::size_t out_stride, const int (&order)[TRANSFORM_3D_FLOATS])
+    {
+        uint32_t entities[4];
+        for (uint32_t lane = 0; lane < 4; ++lane)
+        {
+            entities[lane] = first + (lane < lanes ? lane : lanes - 1);
+        }
+        __m128 position[3], rotation[3], scale[3];
+        gather_xyz(components.positions, components.position_stride, entities, position);
+        gather_xyz(components.rotations, components.rotation_stride, entities, rotation);
+        gather_xyz(components.scales, components.scale_stride, entities, scale);
+
+        const __m128 half = _mm_set1_ps(0.5f);
+        __m128 sin_a1, cos_a1, sin_a2, cos_a2, sin_a3, cos_a3;
+        sincos4(_mm_mul_ps(rotation[1], half), sin_a1, cos_a1);
+        sincos4(_mm_mul_ps(rotation[0], half), sin_a2, cos_a2);
+        sincos4(_mm_mul_ps(rotation[2], half), sin_a3, cos_a3);
+
+        const __m128 s1c2 = _mm_mul_ps(sin_a1, cos_a2);
+        const __m128 c1s2 = _mm_mul_ps(cos_a1, sin_a2);
+        const __m128 s1s2 = _mm_mul_ps(sin_a1, sin_a2);
+        const __m128 c1c2 = _mm_mul_ps(cos_a1, cos_a2);
+        const __m128 x = _mm_add_ps(_mm_mul_ps(s1c2, sin_a3), _mm_mul_ps(c1s2, cos_a3));
+        const __m128 y = _mm_sub_ps(_mm_mul_ps(s1c2, cos_a3), _mm_mul_ps(c1s2, sin_a3));
+        const __m128 z = _mm_sub_ps(_mm_mul_ps(c1c2, sin_a3), _mm_mul_ps(s1s2, cos_a3));
+        const __m128 w = _mm_add_ps(_mm_mul_ps(s1s2, sin_a3), _mm_mul_ps(c1c2, cos_a3));
+
+        const __m128 length_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w)));
+        const __m128 s = _mm_div_ps(_mm_set1_ps(2.0f), length_squared);
+        const __m128 xs = _mm_mul_ps(x, s), ys = _mm_mul_ps(y, s), zs = _mm_mul_ps(z, s);
+        const __m128 wx = _mm_mul_ps(w, xs), wy = _mm_mul_ps(w, ys), wz = _mm_mul_ps(w, zs);
+        const __m128 xx = _mm_mul_ps(x, xs), xy = _mm_mul_ps(x, ys), xz = _mm_mul_ps(x, zs);
+        const __m128 yy = _mm_mul_ps(y, ys), yz = _mm_mul_ps(y, zs), zz = _mm_mul_ps(z, zs);
+        const __m128 one = _mm_set1_ps(1.0f);
+
+        __m128 values[TRANSFORM_3D_FLOATS] = {
+            _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), scale[0]),
+            _mm_mul_ps(_mm_sub_ps(xy, wz), scale[1]),
+            _mm_mul_ps(_mm_add_ps(xz, wy), scale[2]),
+            _mm_mul_ps(_mm_add_ps(xy, wz), scale[0]),
+            _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), scale[1]),
+            _mm_mul_ps(_mm_sub_ps(yz, wx), scale[2]),
+            _mm_mul_ps(_mm_sub_ps(xz, wy), scale[0]),
+            _mm_mul_ps(_mm_add_ps(yz, wx), scale[1]),
+            _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), scale[2]),
+            position[0],
+            position[1],
+            position[2],
+        };
+
+        // Each register holds one value of four transforms; transposing groups of four gives four floats of each transform
+        float lane_values[4][TRANSFORM_3D_FLOATS];
+        for (std::size_t group = 0; group < TRANSFORM_3D_FLOATS; group += 4)
+        {
+            __m128 v0 = values[order[group]];
+            __m128 v1 = values[order[group + 1]];
+            __m128 v2 = values[order[group + 2]];
+            __m128 v3 = values[order[group + 3]];
+            _MM_TRANSPOSE4_PS(v0, v1, v2, v3);
+            if (lanes == 4)
+            {
+                _mm_storeu_ps(out + group, v0);
+                _mm_storeu_ps(out + out_stride + group, v1);
+                _mm_storeu_ps(out + 2 * out_stride + group, v2);
+                _mm_storeu_ps(out + 3 * out_stride + group, v3);
+            }
+            else
+            {
+                _mm_storeu_ps(lane_values[0] + group, v0);
+                _mm_storeu_ps(lane_values[1] + group, v1);
+                _mm_storeu_ps(lane_values[2] + group, v2);
+                _mm_storeu_ps(lane_values[3] + group, v3);
+            }
+        }
+        for (uint32_t lane = 0; lanes < 4 && lane < lanes; ++lane)
+        {
+            std::memcpy(out + lane * out_stride, lane_values[lane], sizeof(lane_values[lane]));
+        }
+    }
+#else
+    void compose_one(const float* position, const float* rotation, const float* scale, float* values)
+    {
+        // R = Y(a1).X(a2).Z(a3)
+        const float sin_a1 = std::sin(rotation[1] * 0.5f);
+        const float cos_a1 = std::cos(rotation[1] * 0.5f);
+        const float sin_a2 = std::sin(rotation[0] * 0.5f);
+        const float cos_a2 = std::cos(rotation[0] * 0.5f);
+        const float sin_a3 = std::sin(rotation[2] * 0.5f);
+        const float cos_a3 = std::cos(rotation[2] * 0.5f);
+
+        const float x = sin_a1 * cos_a2 * sin_a3 + cos_a1 * sin_a2 * cos_a3;
+        const float y = sin_a1 * cos_a2 * cos_a3 - cos_a1 * sin_a2 * sin_a3;
+        const float z = -sin_a1 * sin_a2 * cos_a3 + cos_a1 * cos_a2 * sin_a3;
+        const float w = sin_a1 * sin_a2 * sin_a3 + cos_a1 * cos_a2 * cos_a3;
+
+        const float s = 2.0f / (x * x + y * y + z * z + w * w);
+        const float xs = x * s, ys = y * s, zs = z * s;
+        const float wx = w * xs, wy = w * ys, wz = w * zs;
+        const float xx = x * xs, xy = x * ys, xz = x * zs;
+        const float yy = y * ys, yz = y * zs, zz = z * zs;
+
+        values[0] = (1.0f - (yy + zz)) * scale[0];
+        values[1] = (xy - wz) * scale[1];
+        values[2] = (xz + wy) * scale[2];
+        values[3] = (xy + wz) * scale[0];
+        values[4] = (1.0f - (xx + zz)) * scale[1];
+        values[5] = (yz - wx) * scale[2];
+        values[6] = (xz - wy) * scale[0];
+        values[7] = (yz + wx) * scale[1];
+        values[8] = (1.0f - (xx + yy)) * scale[2];
+        values[9] = position[0];
+        values[10] = position[1];
+        values[11] = position[2];
+    }
+#endif
+}
+
+void utilities::compose_transforms_3d(const Transform3DComponents& components, uint32_t begin, uint32_t end, float* out, std::size_t out_stride, Transform3DLayout layout)
+{
+    const int (&order)[TRANSFORM_3D_FLOATS] = LAYOUT_ORDER[layout == Transform3DLayout::MultiMeshRow ? 1 : 0];
+#ifdef TRANSFORM_KERNELS_SSE2
+    for (uint32_t first = begin; first < end; first += 4, out += 4 * out_stride)
+    {
+        compose_four(components, first, end - first < 4 ? end - first : 4, out, out_stride, order);
+    }
+#else
+    for (uint32_t entity = begin; entity < end; ++entity, out += out_stride)
+    {
+        float values[TRANSFORM_3D_FLOATS];
+        compose_one(components.positions + entity * components.position_stride, components.rotations + entity * components.rotation_stride,
+            components.scales + entity * components.scale_stride, values);
+        for (std::size_t k = 0; k < TRANSFORM_3D_FLOATS; ++k)
+        {
+            out[k] = values[order[k]];
+        }
+    }
+#endif
+}
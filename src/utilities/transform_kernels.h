@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace utilities
+{
+    // Where compose_transforms_3d() writes each transform's 12 floats
+    enum class Transform3DLayout
+    {
+        Transform3D,  // As godot::Transform3D in memory: the basis rows, then the origin
+        MultiMeshRow, // As a MultiMesh buffer row: each basis row followed by that origin component
+    };
+
+    // Position3D, Rotation3D (Euler angles in Godot's default YXZ order) and Scale3D columns viewed as floats, 3 per entity.
+    // A stride of 0 shares the first value with every entity (a column inherited from a prefab).
+    struct Transform3DComponents
+    {
+        const float* positions;
+        const float* rotations;
+        const float* scales;
+        uint32_t position_stride; // In floats: 3, or 0
+        uint32_t rotation_stride;
+        uint32_t scale_stride;
+    };
+
+    // Composes the transforms of entities [begin, end) like Transform3D(Basis(Quaternion::from_euler(rotation), scale), position),
+    // four at a time on SSE2 targets. Entity `begin` goes to `out`, and every next one out_stride floats further.
+    void compose_transforms_3d(const Transform3DComponents& components, uint32_t begin, uint32_t end, float* out, std::size_t out_stride, Transform3DLayout layout);
+}
@@ -0,0 +1,438 @@
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "src/utilities/world_snapshot.h"
+
+namespace
+{
+    constexpr char SNAPSHOT_MAGIC[4] = { 'S', 'W', 'S', 'N' };
+    constexpr uint32_t SNAPSHOT_VERSION = 2;
+
+    struct SnapshotWriter
+    {
+        std::vector<uint8_t>& bytes;
+
+        void write_raw(const void* data, std::size_t size)
+        {
+            const uint8_t* begin = static_cast<const uint8_t*>(data);
+            bytes.insert(bytes.end(), begin, begin + size);
+        }
+
+        template <typename T>
+        void write(T value)
+        {
+            write_raw(&value, sizeof(T));
+        }
+    };
+
+    struct SnapshotReader
+    {
+        const uint8_t* data;
+        std::size_t size;
+        std::size_t offset = 0;
+
+        bool read_raw(void* out, std::size_t count)
+        {
+            if (offset + count > size) { return false; }
+            std::memcpy(out, data + offset, count);
+            offset += count;
+            return true;
+        }
+
+        template <typename T>
+        bool read(T& value)
+        {
+            return read_raw(&value, sizeof(T));
+        }
+
+        // Returns a pointer to `count` bytes in place and skips them
+        const uint8_t* take(std::size_t count)
+        {
+            if (offset + count > size) { return nullptr; }
+            const uint8_t* bytes = data + offset;
+            offset += count;
+            return bytes;
+        }
+    };
+
+    struct CapturedColumn
+    {
+        uint32_t name_index;
+        uint32_t element_size;
+        const uint8_t* values; // Null for tags
+    };
+
+    // Calls `callback(table, offset, count)` once for every table holding prefab instances
+    template <typename CallbackT>
+    void for_each_instance_table(const flecs::world& world, CallbackT&& callback)
+    {
+        flecs::query<> instance_query = world.query_builder()
+            .with(flecs::IsA, flecs::Wildcard)
+            .build();
+
+        // The wildcard matches a table once per IsA pair it has; capture each table once
+        std::unordered_set<const ecs_table_t*> visited_tables;
+        instance_query.run([&](flecs::iter& it) {
+            while (it.next())
+            {
+                const ecs_iter_t* iter = it.c_ptr();
+                if (iter->table == nullptr || iter->count == 0 || !visited_tables.insert(iter->table).second)
+                {
+                    continue;
+                }
+                callback(iter->table, iter->offset, iter->count);
+            }
+        });
+
+        instance_query.destruct();
+    }
+
+    // Calls `callback(component)` for every singleton component with the SnapshotIncluded trait
+    template <typename CallbackT>
+    void for_each_included_singleton(const flecs::world& world, CallbackT&& callback)
+    {
+        const flecs::entity included_trait = world.lookup("SnapshotIncluded");
+        if (!included_trait.is_valid())
+        {
+            return;
+        }
+
+        flecs::query<> singleton_query = world.query_builder()
+            .with(included_trait)
+            .build();
+        singleton_query.each([&](flecs::entity component) { callback(component); });
+        singleton_query.destruct();
+    }
+}
+
+std::vector<uint8_t> utilities::WorldSnapshot::capture(const flecs::world& world)
+{
+    ecs_world_t* c_world = const_cast<ecs_world_t*>(world.c_ptr());
+    const flecs::entity excluded_trait = world.lookup("SnapshotExcluded");
+
+    std::vector<std::string> names;
+    std::unordered_map<ecs_id_t, uint32_t> name_indices;
+    auto get_name_index = [&](ecs_id_t id) -> uint32_t {
+        auto found = name_indices.find(id);
+        if (found != name_indices.end()) { return found->second; }
+        const uint32_t name_index = static_cast<uint32_t>(names.size());
+        names.push_back(flecs::entity(c_world, id).path().c_str());
+        name_indices.emplace(id, name_index);
+        return name_index;
+    };
+
+    // Table records are gathered first, the name table is written ahead of them
+    std::vector<uint8_t> table_bytes;
+    SnapshotWriter table_writer{ table_bytes };
+    uint32_t table_count = 0;
+    std::vector<CapturedColumn> columns;
+
+    for_each_instance_table(world, [&](const ecs_table_t* table, int32_t offset, int32_t count) {
+        const ecs_type_t* type = ecs_table_get_type(table);
+        ecs_entity_t prefab = 0;
+        columns.clear();
+
+        for (int32_t type_index = 0; type_index < type->count; ++type_index)
+        {
+            const ecs_id_t id = type->array[type_index];
+            if (ECS_IS_PAIR(id))
+            {
+                if (prefab == 0 && ECS_PAIR_FIRST(id) == EcsIsA)
+                {
+                    prefab = ecs_pair_second(c_world, id);
+                }
+                continue; // Names, hierarchies and other relationships are not captured
+            }
+
+            if (excluded_trait.is_valid() && ecs_has_id(c_world, id, excluded_trait.id()))
+            {
+                continue;
+            }
+
+            const int32_t column_index = ecs_table_type_to_column_index(table, type_index);
+            if (column_index < 0)
+            {
+                columns.push_back({ get_name_index(id), 0U, nullptr }); // Tag
+                continue;
+            }
+
+            const ecs_type_info_t* type_info = ecs_get_type_info(c_world, id);
+            if (type_info == nullptr || type_info->hooks.copy != nullptr || type_info->hooks.dtor != nullptr)
+            {
+                continue; // Not plain data, the restored entity gets the prefab's value or a default constructed one
+            }
+
+            const uint8_t* values = static_cast<const uint8_t*>(ecs_table_get_column(const_cast<ecs_table_t*>(table), column_index, offset));
+            columns.push_back({ get_name_index(id), static_cast<uint32_t>(type_info->size), values });
+        }
+
+        if (prefab == 0)
+        {
+            return;
+        }
+
+        table_writer.write<uint32_t>(get_name_index(prefab));
+        table_writer.write<uint32_t>(static_cast<uint32_t>(count));
+        table_writer.write<uint32_t>(static_cast<uint32_t>(columns.size()));
+        for (const CapturedColumn& column : columns)
+        {
+            table_writer.write<uint32_t>(column.name_index);
+            table_writer.write<uint32_t>(column.element_size);
+            if (column.element_size > 0)
+            {
+                table_writer.write_raw(column.values, static_cast<std::size_t>(column.element_size) * static_cast<std::size_t>(count));
+            }
+        }
+        table_count++;
+    });
+
+    // Singletons live on their component entity: the value of (component, component)
+    std::vector<uint8_t> singleton_bytes;
+    SnapshotWriter singleton_writer{ singleton_bytes };
+    uint32_t singleton_count = 0;
+    for_each_included_singleton(world, [&](flecs::entity component) {
+        const ecs_type_info_t* type_info = ecs_get_type_info(c_world, component.id());
+        const void* value = ecs_get_id(c_world, component.id(), component.id());
+        if (type_info == nullptr || value == nullptr)
+        {
+            return;
+        }
+
+        singleton_writer.write<uint32_t>(get_name_index(component.id()));
+        singleton_writer.write<uint32_t>(static_cast<uint32_t>(type_info->size));
+        singleton_writer.write_raw(value, static_cast<std::size_t>(type_info->size));
+        singleton_count++;
+    });
+
+    std::vector<uint8_t> bytes;
+    SnapshotWriter writer{ bytes };
+    writer.write_raw(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    writer.write<uint32_t>(SNAPSHOT_VERSION);
+    writer.write<uint32_t>(static_cast<uint32_t>(names.size()));
+    for (const std::string& name : names)
+    {
+        writer.write<uint32_t>(static_cast<uint32_t>(name.size()));
+        writer.write_raw(name.data(), name.size());
+    }
+    writer.write<uint32_t>(table_count);
+    writer.write_raw(table_bytes.data(), table_bytes.size());
+    writer.write<uint32_t>(singleton_count);
+    writer.write_raw(singleton_bytes.data(), singleton_bytes.size());
+    return bytes;
+}
+
+bool utilities::WorldSnapshot::restore(flecs::world& world, const uint8_t* data, std::size_t size, std::string& error)
+{
+    ecs_world_t* c_world = world.c_ptr();
+    SnapshotReader reader{ data, size };
+
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    uint32_t version = 0;
+    if (!reader.read_raw(magic, sizeof(magic)) || std::memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0 || !reader.read(version) || version != SNAPSHOT_VERSION)
+    {
+        error = "not a world snapshot, or written by a different version";
+        return false;
+    }
+
+    // Resolve every component and prefab before touching the world, so a bad snapshot leaves it intact
+    uint32_t name_count = 0;
+    if (!reader.read(name_count))
+    {
+        error = "truncated name table";
+        return false;
+    }
+    std::vector<ecs_entity_t> name_entities(name_count, 0);
+    for (uint32_t name_index = 0; name_index < name_count; ++name_index)
+    {
+        uint32_t name_length = 0;
+        const uint8_t* name_chars = nullptr;
+        if (!reader.read(name_length) || (name_chars = reader.take(name_length)) == nullptr)
+        {
+            error = "truncated name table";
+            return false;
+        }
+        const std::string name(reinterpret_cast<const char*>(name_chars), name_length);
+        const flecs::entity entity = world.lookup(name.c_str());
+        if (!entity.is_valid())
+        {
+            error = "unknown component or prefab '" + name + "'";
+            return false;
+        }
+        name_entities[name_index] = entity.id();
+    }
+
+    struct RestoredColumn
+    {
+        ecs_id_t id;
+        uint32_t element_size;
+        const uint8_t* values;
+    };
+    struct RestoredTable
+    {
+        ecs_entity_t prefab;
+        uint32_t entity_count;
+        std::vector<RestoredColumn> columns;
+    };
+
+    uint32_t table_count = 0;
+    if (!reader.read(table_count))
+    {
+        error = "truncated table list";
+        return false;
+    }
+    std::vector<RestoredTable> tables(table_count);
+    for (RestoredTable& table : tables)
+    {
+        uint32_t prefab_index = 0;
+        uint32_t column_count = 0;
+        if (!reader.read(prefab_index) || !reader.read(table.entity_count) || !reader.read(column_count) || prefab_index >= name_count)
+        {
+            error = "truncated or malformed table";
+            return false;
+        }
+        table.prefab = name_entities[prefab_index];
+        table.columns.resize(column_count);
+
+        for (RestoredColumn& column : table.columns)
+        {
+            uint32_t name_index = 0;
+            if (!reader.read(name_index) || !reader.read(column.element_size) || name_index >= name_count)
+            {
+                error = "truncated or malformed column";
+                return false;
+            }
+            column.id = name_entities[name_index];
+
+            const ecs_type_info_t* type_info = ecs_get_type_info(c_world, column.id);
+            const uint32_t expected_size = type_info != nullptr ? static_cast<uint32_t>(type_info->size) : 0U;
+            if (expected_size != column.element_size)
+            {
+                error = std::string("size of component '") + flecs::entity(c_world, column.id).path().c_str() + "' does not match the snapshot";
+                return false;
+            }
+
+            column.values = nullptr;
+            if (column.element_size > 0
+                && (column.values = reader.take(static_cast<std::size_t>(column.element_size) * table.entity_count)) == nullptr)
+            {
+                error = "truncated column data";
+                return false;
+            }
+        }
+    }
+
+    struct RestoredSingleton
+    {
+        ecs_entity_t component;
+        uint32_t size;
+        const uint8_t* value;
+    };
+
+    uint32_t singleton_count = 0;
+    if (!reader.read(singleton_count))
+    {
+        error = "truncated singleton list";
+        return false;
+    }
+    std::vector<RestoredSingleton> singletons(singleton_count);
+    for (RestoredSingleton& singleton : singletons)
+    {
+        uint32_t name_index = 0;
+        if (!reader.read(name_index) || !reader.read(singleton.size) || name_index >= name_count)
+        {
+            error = "truncated or malformed singleton";
+            return false;
+        }
+        singleton.component = name_entities[name_index];
+
+        const ecs_type_info_t* type_info = ecs_get_type_info(c_world, singleton.component);
+        if (type_info == nullptr || static_cast<uint32_t>(type_info->size) != singleton.size)
+        {
+            error = std::string("size of singleton '") + flecs::entity(c_world, singleton.component).path().c_str() + "' does not match the snapshot";
+            return false;
+        }
+        if ((singleton.value = reader.take(singleton.size)) == nullptr)
+        {
+            error = "truncated singleton data";
+            return false;
+        }
+    }
+
+    delete_prefab_instances(world);
+
+    for (const RestoredSingleton& singleton : singletons)
+    {
+        ecs_set_id(c_world, singleton.component, singleton.component, singleton.size, singleton.value);
+    }
+
+    for (const RestoredTable& table : tables)
+    {
+        if (table.entity_count == 0)
+        {
+            continue;
+        }
+
+        // One bulk operation per table: the entities land in their final table in one move. ids must be zero terminated,
+        // columns that don't fit are set per entity afterwards.
+        ecs_bulk_desc_t bulk_desc = {};
+        void* bulk_data[FLECS_ID_DESC_MAX] = {};
+        bulk_desc.count = static_cast<int32_t>(table.entity_count);
+        bulk_desc.ids[0] = ecs_pair(EcsIsA, table.prefab);
+
+        std::size_t bulk_id_count = 1;
+        std::size_t column_idx = 0;
+        for (; column_idx < table.columns.size() && bulk_id_count < FLECS_ID_DESC_MAX - 1; ++column_idx)
+        {
+            bulk_desc.ids[bulk_id_count] = table.columns[column_idx].id;
+            bulk_data[bulk_id_count] = const_cast<uint8_t*>(table.columns[column_idx].values);
+            bulk_id_count++;
+        }
+        bulk_desc.data = bulk_data;
+
+        const ecs_entity_t* entities = ecs_bulk_init(c_world, &bulk_desc);
+        if (entities == nullptr)
+        {
+            continue;
+        }
+
+        for (; column_idx < table.columns.size(); ++column_idx)
+        {
+            const RestoredColumn& column = table.columns[column_idx];
+            for (uint32_t entity_idx = 0; entity_idx < table.entity_count; ++entity_idx)
+            {
+                if (column.element_size == 0)
+                {
+                    ecs_add_id(c_world, entities[entity_idx], column.id);
+                }
+                else
+                {
+                    ecs_set_id(c_world, entities[entity_idx], column.id, column.element_size, column.values + static_cast<std::size_t>(column.element_size) * entity_idx);
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+void utilities::WorldSnapshot::delete_prefab_instances(flecs::world& world)
+{
+    std::unordered_set<ecs_entity_t> prefabs;
+    for_each_instance_table(world, [&](const ecs_table_t* table, int32_t, int32_t) {
+        const ecs_type_t* type = ecs_table_get_type(table);
+        for (int32_t type_index = 0; type_index < type->count; ++type_index)
+        {
+            const ecs_id_t id = type->array[type_index];
+            if (ECS_IS_PAIR(id) && ECS_PAIR_FIRST(id) == EcsIsA)
+            {
+                prefabs.insert(ecs_pair_second(world.c_ptr(), id));
+            }
+        }
+    });
+
+    for (ecs_entity_t prefab : prefabs)
+    {
+        world.delete_with(flecs::IsA, prefab);
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <flecs.h>
+
+// Trait for components that must not be captured by world snapshots, typically handles to resources that are freed when the
+// component is removed (physics bodies, ...). Restored entities don't get the component.
+struct SnapshotExcluded {};
+
+template <typename T>
+void exclude_from_snapshots(flecs::world& world)
+{
+    world.component<SnapshotExcluded>("SnapshotExcluded");
+    world.component<T>().template add<SnapshotExcluded>();
+}
+
+// Trait for singletons that world snapshots capture along with the prefab instances, such as the state of a system that spawns
+// them. Only plain data can be captured.
+struct SnapshotIncluded {};
+
+template <typename T>
+void include_in_snapshots(flecs::world& world)
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Only plain-data singletons can be captured by world snapshots");
+    world.component<SnapshotIncluded>("SnapshotIncluded");
+    world.component<T>().template add<SnapshotIncluded>();
+}
+
+namespace utilities
+{
+    // Binary snapshots of all prefab instances, as raw columns of their plain-data components, and of the SnapshotIncluded
+    // singletons. Components with hooks or the SnapshotExcluded trait are skipped, restored entities get those from their prefab.
+    class WorldSnapshot
+    {
+    public:
+        static std::vector<uint8_t> capture(const flecs::world& world);
+
+        // Deletes all prefab instances, then bulk-creates the entities of the snapshot and sets its singletons. Returns false
+        // (with `error` set) when the snapshot is malformed or refers to components or prefabs the world doesn't have.
+        static bool restore(flecs::world& world, const uint8_t* data, std::size_t size, std::string& error);
+
+        // Deletes all prefab instances with one delete_with() per prefab. The tables stay allocated, so respawning the same
+        // kinds of entities doesn't re-create tables or re-match queries.
+        static void delete_prefab_instances(flecs::world& world);
+    };
+}
@@ -1,16 +1,28 @@
+#include <algorithm>
+#include <cstring>
 #include <thread>
-#include <cctype>
+#include <cmath>
 
 #include <godot_cpp/core/class_db.hpp>
 #include <godot_cpp/core/defs.hpp>
+#include <godot_cpp/classes/camera2d.hpp>
+#include <godot_cpp/classes/camera3d.hpp>
 #include <godot_cpp/classes/engine.hpp>
 #include <godot_cpp/classes/multi_mesh.hpp>
 #include <godot_cpp/classes/multi_mesh_instance2d.hpp>
 #include <godot_cpp/classes/multi_mesh_instance3d.hpp>
+#include <godot_cpp/classes/os.hpp>
+#include <godot_cpp/classes/performance.hpp>
+#include <godot_cpp/classes/project_settings.hpp>
 #include <godot_cpp/classes/rendering_server.hpp>
 #include <godot_cpp/classes/viewport.hpp>
 #include <godot_cpp/classes/world2d.hpp>
 #include <godot_cpp/classes/world3d.hpp>
+#include <godot_cpp/variant/callable_method_pointer.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/packed_float32_array.hpp>
+#include <godot_cpp/variant/packed_int32_array.hpp>
+#include <godot_cpp/variant/packed_vector2_array.hpp>
 #include <godot_cpp/variant/utility_functions.hpp>
 
 #include "src/world.h"
@@ -30,10 +42,9 @@
 #include "src/systems/transform_update.h"
 #include "src/systems/entity_rendering.h"
 
+#include "src/utilities/godot_event_queue.h"
 #include "src/utilities/godot_signal.h"
-
-// Define the global buffer cache that is declared in entity_rendering.h
-std::unordered_map<godot::RID, godot::PackedFloat32Array> g_multimesh_buffer_cache;
+#include "src/utilities/prefab_batch_spawn.h"
 
 using godot::ClassDB;
 using godot::D_METHOD;
@@ -62,35 +73,38 @@ FlecsWorld::FlecsWorld()
     flecs::log::set_level(1);
 #endif
 
-    // Set the number of threads Flecs should use based on CPU thread count
-    unsigned int num_threads = ::utilities::Platform::get_thread_count();
-
-    // I'm suspecting that the thread exhaustion in the Web builds are caused by this
-    // In this project the systems are single-threaded anyway.
-    // world.set_threads(static_cast<int>(num_threads));
+    // Set the number of threads Flecs should use. The count comes from the "flecs/threading/thread_count" project setting,
+    // which falls back to the main thread only on the web where workers exhaust the browser's pthread pool.
+    // Only systems marked multi_threaded() are split across the workers; everything else still runs on the main thread.
+    unsigned int num_threads = ::utilities::Platform::get_configured_thread_count();
+    if (num_threads > 1)
+    {
+        world.set_threads(static_cast<int>(num_threads));
+    }
 
     register_components_and_systems_with_world(world);
 
-    // Populate the instance's singleton setters from the global registry
-    for (const auto& pair : get_singleton_setters())
-    {
-        const std::string& component_name = pair.first;
-        const FlecsSingletonSetter& global_setter = pair.second;
-        singleton_setters[component_name] = [this, global_setter](const godot::Variant& data) { global_setter(this->world, data); };
-    }
+    // Physics bodies report their state through these whenever they move, see PhysicsBodyStates2D
+    physics_body_state_sync_2d = callable_mp(this, &FlecsWorld::queue_physics_body_state_2d);
+    physics_body_state_sync_3d = callable_mp(this, &FlecsWorld::queue_physics_body_state_3d);
+    world.try_get_mut<PhysicsBodyStates2D>()->sync_callback = &physics_body_state_sync_2d;
+    world.try_get_mut<PhysicsBodyStates3D>()->sync_callback = &physics_body_state_sync_3d;
+
+    // Rendering runs on demand after the simulation ticks of each frame, see progress()
+    entity_rendering_system = world.lookup("Entity Rendering (MultiMesh)");
+    viewport_culling_system = world.lookup("Viewport Culling");
+
+    build_singleton_accessors();
 
-    // Populate the instance's singleton getters from the global registry
-    for (const auto& pair : get_singleton_getters())
-    {
-        const std::string& component_name = pair.first;
-        const FlecsSingletonGetter& global_getter = pair.second;
-        singleton_getters[component_name] = [this, global_getter]() { return global_getter(this->world); };
-    }
     // Load Flecs script files that live in the project's flecs_scripts folder.
     // Use a Godot resource path so the loader can resolve it via ProjectSettings.
     FlecsScriptsLoader loader;
     loader.load(world);
 
+    // Always-on per-system timings, after the scripts so their systems are tracked too. Flecs only reads the clock around each
+    // system run, which is cheap enough for release builds.
+    system_timings.track_systems(world);
+
     world.observer("GodotSignalObserver")
         .event<GodotSignal>()
         .with(flecs::Any) // Tells the observer: "I don't care what components the entity has. If any entity emits this event, trigger the callback."
@@ -105,6 +119,80 @@ FlecsWorld::FlecsWorld()
 }
 
 
+void FlecsWorld::build_singleton_accessors()
+{
+    // Collect every component that has a setter and/or a getter in the global registry.
+    // Sorting the names keeps the handles stable between runs.
+    std::vector<std::string> component_names;
+    for (const auto& pair : get_singleton_setters())
+    {
+        component_names.push_back(pair.first);
+    }
+    for (const auto& pair : get_singleton_getters())
+    {
+        if (get_singleton_setters().find(pair.first) == get_singleton_setters().end())
+        {
+            component_names.push_back(pair.first);
+        }
+    }
+    std::sort(component_names.begin(), component_names.end());
+
+    singleton_accessors.clear();
+    singleton_handles.clear();
+    singleton_accessors.reserve(component_names.size());
+    for (const std::string& component_name : component_names)
+    {
+        auto setter = get_singleton_setters().find(component_name);
+        auto getter = get_singleton_getters().find(component_name);
+        singleton_handles[component_name] = static_cast<int64_t>(singleton_accessors.size());
+        singleton_accessors.push_back({
+            component_name,
+            setter != get_singleton_setters().end() ? &setter->second : nullptr,
+            getter != get_singleton_getters().end() ? &getter->second : nullptr
+        });
+    }
+}
+
+namespace
+{
+    // Reads the optional "render_update" metadata of a renderer node. Returns true for "static", false for "dynamic" (the default).
+    bool get_render_update_hint(godot::Node* renderer_node)
+    {
+        if (!renderer_node->has_meta("render_update"))
+        {
+            return false;
+        }
+
+        const godot::String render_update = renderer_node->get_meta("render_update");
+        if (render_update == "static")
+        {
+            return true;
+        }
+        if (render_update != "dynamic")
+        {
+            UtilityFunctions::push_warning(godot::String("Child node '") + renderer_node->get_name() + "' has unknown 'render_update' metadata '" + render_update + "', expected 'static' or 'dynamic'.");
+        }
+        return false;
+    }
+
+    // Reads the "draw_order" metadata of a renderer node: "X", "Y", "Z" or "camera" (the last two for 3D only), case-insensitive.
+    DrawOrder get_draw_order_hint(godot::Node* renderer_node, bool is_3d)
+    {
+        const godot::Variant meta_value = renderer_node->get_meta("draw_order");
+        if (meta_value.get_type() == godot::Variant::STRING || meta_value.get_type() == godot::Variant::STRING_NAME)
+        {
+            const godot::String draw_order = godot::String(meta_value).to_lower();
+            if (draw_order == "x") { return DrawOrder::X; }
+            if (draw_order == "y") { return DrawOrder::Y; }
+            if (draw_order == "z" && is_3d) { return DrawOrder::Z; }
+            if (draw_order == "camera" && is_3d) { return DrawOrder::CameraDepth; }
+        }
+
+        UtilityFunctions::push_warning(godot::String("Child node '") + renderer_node->get_name() + "' has unsupported 'draw_order' metadata, expected " + (is_3d ? "'X', 'Y', 'Z' or 'camera'." : "'X' or 'Y'."));
+        return DrawOrder::None;
+    }
+}
+
 void FlecsWorld::setup_entity_renderers()
 {
     EntityRenderers renderers;
@@ -136,9 +224,6 @@ void FlecsWorld::setup_entity_renderers()
         if (multimesh)
         {
             multimesh_rid = multimesh->get_rid();
-
-            // Pre-populate the buffer cache to avoid the initial resizing
-            g_multimesh_buffer_cache[multimesh_rid] = multimesh->get_buffer();
         }
         else
         {
@@ -169,103 +254,159 @@ void FlecsWorld::setup_entity_renderers()
             it->second.use_custom_data = multimesh->is_using_custom_data();
             it->second.instance_count = multimesh->get_instance_count();
             it->second.visible_instance_count = multimesh->get_visible_instance_count();
+            it->second.pack_kernel = ::utilities::select_multimesh_pack_kernel(
+                it->second.transform_format == godot::MultiMesh::TRANSFORM_3D, it->second.use_colors, it->second.use_custom_data);
+            it->second.multimesh = godot::Ref<godot::MultiMesh>(multimesh);
+            it->second.name = child->get_name();
+
+            // Allocate the buffer ring up front, so rendering never resizes a buffer unless the instance count changes
+            const int64_t buffer_size = static_cast<int64_t>(it->second.instance_count * ::utilities::get_multimesh_row_floats(
+                it->second.transform_format == godot::MultiMesh::TRANSFORM_3D, it->second.use_colors, it->second.use_custom_data));
+            for (godot::PackedFloat32Array& buffer : it->second.buffers)
+            {
+                buffer.resize(buffer_size);
+            }
+            it->second.is_static = get_render_update_hint(child);
             renderer_count++;
         }
         MultiMeshRenderer* mm_renderer = &it->second;
+        const bool is_2d = multimesh->get_transform_format() == godot::MultiMesh::TRANSFORM_2D;
 
-        // Build a single query for all prefabs associated with this renderer.
-        // This ensures that entities from different prefabs are sorted together.
-        auto qb = world.query_builder();
-
-        // If a draw order sorting axis is specified in metadata, set up the ordering.
-        // Warning: This is expensive. Measured 11x slowdown when sorting 40k entities vs no sorting.
-        char sort_axis = '\0';
-        if (child->has_meta("draw_order")) {
-            godot::Variant meta_val = child->get_meta("draw_order");
-            if (meta_val.get_type() == godot::Variant::STRING || meta_val.get_type() == godot::Variant::STRING_NAME) {
-                godot::String sort_axis_str = meta_val;
-                if (sort_axis_str.length() == 1) {
-                    sort_axis = std::tolower(sort_axis_str.utf8().get_data()[0]);
-                }
-            }
+        // The draw order is applied by the packer (see update_renderer_for_prefab) rather than with order_by on the query,
+        // which re-sorted the whole query with a comparison sort whenever a table changed.
+        if (child->has_meta("draw_order") && inserted)
+        {
+            mm_renderer->draw_order = get_draw_order_hint(child, !is_2d);
         }
 
-        if (multimesh->get_transform_format() == godot::MultiMesh::TRANSFORM_2D)
-        {
-            qb.with<const godot::Transform2D>();
-            if (sort_axis != '\0') {
-                switch (sort_axis) {
-                case 'x':
-                    qb.order_by<godot::Transform2D>(
-                        [](flecs::entity_t, const godot::Transform2D* t1, flecs::entity_t, const godot::Transform2D* t2) {
-                        if (t1->get_origin().x > t2->get_origin().x) return 1; if (t1->get_origin().x < t2->get_origin().x) return -1; return 0;
-                    });
-                    break;
-                case 'y':
-                    qb.order_by<godot::Transform2D>(
-                        [](flecs::entity_t, const godot::Transform2D* t1, flecs::entity_t, const godot::Transform2D* t2) {
-                        if (t1->get_origin().y > t2->get_origin().y) return 1; if (t1->get_origin().y < t2->get_origin().y) return -1; return 0;
-                    });
-                    break;
-                default:
-                    // z-axis is not applicable for 2D, so we ignore it.
-                    break;
-                }
+        if (child->has_meta("cull_margin") && inserted)
+        {
+            const godot::Variant cull_margin = child->get_meta("cull_margin");
+            if (!is_2d)
+            {
+                UtilityFunctions::push_warning(godot::String("Child node '") + child->get_name() + "' has 'cull_margin' metadata, but viewport culling is only supported for 2D renderers.");
+            }
+            else if (cull_margin.get_type() != godot::Variant::INT && cull_margin.get_type() != godot::Variant::FLOAT)
+            {
+                UtilityFunctions::push_warning(godot::String("Child node '") + child->get_name() + "' has 'cull_margin' metadata that is not a number.");
+            }
+            else
+            {
+                mm_renderer->cull = true;
+                mm_renderer->cull_margin = static_cast<float>(static_cast<double>(cull_margin));
             }
         }
-        else
-        {
-            qb.with<const godot::Transform3D>();
-            if (sort_axis != '\0') {
-                switch (sort_axis) {
-                case 'x':
-                    qb.order_by<godot::Transform3D>(
-                        [](flecs::entity_t, const godot::Transform3D* t1, flecs::entity_t, const godot::Transform3D* t2) {
-                        if (t1->origin.x > t2->origin.x) return 1; if (t1->origin.x < t2->origin.x) return -1; return 0;
-                    });
-                    break;
-                case 'y':
-                    qb.order_by<godot::Transform3D>(
-                        [](flecs::entity_t, const godot::Transform3D* t1, flecs::entity_t, const godot::Transform3D* t2) {
-                        if (t1->origin.y > t2->origin.y) return 1; if (t1->origin.y < t2->origin.y) return -1; return 0;
-                    });
-                    break;
-                case 'z':
-                    qb.order_by<godot::Transform3D>(
-                        [](flecs::entity_t, const godot::Transform3D* t1, flecs::entity_t, const godot::Transform3D* t2) {
-                        if (t1->origin.z > t2->origin.z) return 1; if (t1->origin.z < t2->origin.z) return -1; return 0;
-                    });
-                    break;
+
+        // Chain prefabs with the OR operator. The logic is to add `.or_()` to all but the last term.
+        auto add_prefab_terms = [&](flecs::query_builder<>& builder) {
+            int prefab_count = prefabs.size();
+            for (int j = 0; j < prefab_count; ++j)
+            {
+                godot::String prefab_name = prefabs[j];
+                std::string prefab_name_str = prefab_name.utf8().get_data();
+                builder.with(flecs::IsA, world.lookup(prefab_name_str.c_str()));
+                if (j < prefab_count - 1) {
+                    builder.or_();
                 }
             }
-        }
+        };
 
-        if (multimesh->is_using_colors())
-        {
-            qb.with<const RenderingColor>();
-        }
-        if (multimesh->is_using_custom_data())
-        {
-            qb.with<const RenderingCustomData>();
-        }
+        // Build a single query for all prefabs associated with this renderer.
+        // This ensures that entities from different prefabs are sorted together.
+        // Cached with change detection, so the renderer can skip tables (and whole renderers) nothing wrote to since the last upload.
+        // A second one matches the entities rendered from their transform components: TranslationOnly2D entities from their
+        // Position2D, ComposedTransform3D entities from their Position3D, Rotation3D and Scale3D.
+        auto build_render_query = [&](bool from_components) {
+            auto qb = world.query_builder()
+                .cached()
+                .detect_changes();
 
-        // Chain prefabs with the OR operator. The logic is to add `.or_()` to all but the last term.
-        int prefab_count = prefabs.size();
-        for (int j = 0; j < prefab_count; ++j)
-        {
-            godot::String prefab_name = prefabs[j];
-            std::string prefab_name_str = prefab_name.utf8().get_data();
-            qb.with(flecs::IsA, world.lookup(prefab_name_str.c_str()));
-            if (j < prefab_count - 1) {
-                qb.or_();
+            if (from_components && is_2d)
+            {
+                qb.with<const Position2D>();
+                qb.with<const PreviousPosition2D>().optional();
             }
-        }
+            else if (from_components)
+            {
+                qb.with<const Position3D>();
+                qb.with<const Rotation3D>();
+                qb.with<const Scale3D>();
+            }
+            else if (is_2d)
+            {
+                qb.with<const godot::Transform2D>();
+                qb.with<const PreviousTransform2D>().optional(); // Used for fixed-timestep interpolation when present
+            }
+            else
+            {
+                qb.with<const godot::Transform3D>();
+                qb.with<const PreviousTransform3D>().optional();
+            }
+
+            if (multimesh->is_using_colors())
+            {
+                qb.with<const RenderingColor>();
+            }
+            if (multimesh->is_using_custom_data())
+            {
+                qb.with<const RenderingCustomData>();
+            }
+
+            const flecs::entity_t components_tag = is_2d ? world.id<TranslationOnly2D>() : world.id<ComposedTransform3D>();
+            if (from_components)
+            {
+                qb.with(components_tag);
+            }
+            else
+            {
+                qb.without(components_tag);
+            }
+            add_prefab_terms(qb);
+
+            if (mm_renderer->cull)
+            {
+                // Disabled OnScreen tags are skipped by the query iterator, which hands out the enabled rows as contiguous ranges
+                qb.with<OnScreen>();
+            }
+            return qb.build();
+        };
 
-        mm_renderer->queries.push_back(qb.build());
+        // Only the origin, without the OnScreen filter or change detection
+        auto build_instance_query = [&](bool from_components) {
+            auto instance_qb = world.query_builder()
+                .cached();
+            if (from_components)
+            {
+                instance_qb.with<const Position2D>();
+                instance_qb.with<TranslationOnly2D>();
+            }
+            else
+            {
+                instance_qb.with<const godot::Transform2D>();
+                instance_qb.without<TranslationOnly2D>();
+            }
+            add_prefab_terms(instance_qb);
+            return instance_qb.build();
+        };
+
+        mm_renderer->queries.push_back(build_render_query(false));
+        mm_renderer->component_queries.push_back(build_render_query(true));
+        if (is_2d)
+        {
+            mm_renderer->instance_queries.push_back(build_instance_query(false));
+            mm_renderer->component_instance_queries.push_back(build_instance_query(true));
+        }
     }
 
     if (renderer_count > 0)
     {
+        // Renderers are packed after world.progress(), while the Flecs workers are idle, so the packing threads get the same count
+        const unsigned int packing_thread_count = ::utilities::Platform::get_configured_thread_count();
+        if (packing_thread_count > 1)
+        {
+            renderers.packing_workers = std::make_shared<::utilities::ParallelFor>(packing_thread_count);
+        }
+
         world.component<EntityRenderers>();
         world.set<EntityRenderers>(renderers);
         UtilityFunctions::print(godot::String("Found and registered ") +
@@ -302,12 +443,247 @@ void FlecsWorld::update_physics_spaces()
     }
 }
 
+void FlecsWorld::queue_physics_body_state_2d(godot::PhysicsDirectBodyState2D* state, int64_t entity_id)
+{
+    if (!state) { return; }
+    const PhysicsBodyState2D body_state{ static_cast<flecs::entity_t>(entity_id), state->get_transform(), state->get_linear_velocity() };
+    std::lock_guard<std::mutex> lock(received_body_states_mutex);
+    received_body_states_2d.push_back(body_state);
+}
+
+void FlecsWorld::queue_physics_body_state_3d(godot::PhysicsDirectBodyState3D* state, int64_t entity_id)
+{
+    if (!state) { return; }
+    const PhysicsBodyState3D body_state{ static_cast<flecs::entity_t>(entity_id), state->get_transform(), state->get_linear_velocity() };
+    std::lock_guard<std::mutex> lock(received_body_states_mutex);
+    received_body_states_3d.push_back(body_state);
+}
+
+// Moves the states the callbacks received since the last frame into the singletons the feedback systems drain
+void FlecsWorld::hand_over_physics_body_states()
+{
+    PhysicsBodyStates2D* body_states_2d = world.try_get_mut<PhysicsBodyStates2D>();
+    PhysicsBodyStates3D* body_states_3d = world.try_get_mut<PhysicsBodyStates3D>();
+    std::lock_guard<std::mutex> lock(received_body_states_mutex);
+    if (body_states_2d)
+    {
+        body_states_2d->states.insert(body_states_2d->states.end(), received_body_states_2d.begin(), received_body_states_2d.end());
+        received_body_states_2d.clear();
+    }
+    if (body_states_3d)
+    {
+        body_states_3d->states.insert(body_states_3d->states.end(), received_body_states_3d.begin(), received_body_states_3d.end());
+        received_body_states_3d.clear();
+    }
+}
+
+void FlecsWorld::add_performance_monitors()
+{
+    godot::Performance* performance = godot::Performance::get_singleton();
+    if (!performance)
+    {
+        return;
+    }
+
+    for (size_t system_index = 0; system_index < system_timings.get_system_count(); ++system_index)
+    {
+        godot::StringName monitor_id = godot::String("Flecs/") + godot::String::utf8(system_timings.get_system_name(system_index).c_str()) + " (usec)";
+        if (performance->has_custom_monitor(monitor_id))
+        {
+            continue; // Another FlecsWorld already owns this monitor
+        }
+
+        performance->add_custom_monitor(monitor_id, callable_mp(this, &FlecsWorld::get_system_frame_usec).bind(static_cast<int>(system_index)));
+        performance_monitor_ids.push_back(monitor_id);
+    }
+
+    const EntityRenderers* renderers = world.try_get<EntityRenderers>();
+    if (renderers == nullptr) { return; }
+    auto multimesh_renderers_it = renderers->renderers_by_type.find(RendererType::MultiMesh);
+    if (multimesh_renderers_it == renderers->renderers_by_type.end()) { return; }
+
+    // One monitor per renderer, so a renderer that uploads every frame although nothing moved stands out
+    for (const auto& [renderer_rid, renderer] : multimesh_renderers_it->second)
+    {
+        godot::StringName monitor_id = godot::String("Flecs/MultiMesh upload ") + renderer.name + " (bytes)";
+        if (performance->has_custom_monitor(monitor_id))
+        {
+            continue;
+        }
+
+        performance->add_custom_monitor(monitor_id, callable_mp(this, &FlecsWorld::get_renderer_uploaded_bytes).bind(renderer_rid));
+        performance_monitor_ids.push_back(monitor_id);
+    }
+}
+
+void FlecsWorld::remove_performance_monitors()
+{
+    godot::Performance* performance = godot::Performance::get_singleton();
+    if (performance)
+    {
+        for (const godot::StringName& monitor_id : performance_monitor_ids)
+        {
+            if (performance->has_custom_monitor(monitor_id))
+            {
+                performance->remove_custom_monitor(monitor_id);
+            }
+        }
+    }
+    performance_monitor_ids.clear();
+}
+
+double FlecsWorld::get_system_frame_usec(int system_index) const
+{
+    return system_timings.get_last_frame_usec(static_cast<size_t>(system_index));
+}
+
+int64_t FlecsWorld::get_renderer_uploaded_bytes(const godot::RID& renderer_rid) const
+{
+    const EntityRenderers* renderers = world.try_get<EntityRenderers>();
+    if (renderers == nullptr) { return 0; }
+    auto multimesh_renderers_it = renderers->renderers_by_type.find(RendererType::MultiMesh);
+    if (multimesh_renderers_it == renderers->renderers_by_type.end()) { return 0; }
+    auto renderer_it = multimesh_renderers_it->second.find(renderer_rid);
+    return renderer_it != multimesh_renderers_it->second.end() ? renderer_it->second.uploaded_bytes : 0;
+}
+
+godot::Dictionary FlecsWorld::get_render_upload_stats() const
+{
+    godot::Dictionary stats;
+    const EntityRenderers* renderers = is_initialised ? world.try_get<EntityRenderers>() : nullptr;
+    if (renderers == nullptr) { return stats; }
+    auto multimesh_renderers_it = renderers->renderers_by_type.find(RendererType::MultiMesh);
+    if (multimesh_renderers_it == renderers->renderers_by_type.end()) { return stats; }
+
+    for (const auto& [renderer_rid, renderer] : multimesh_renderers_it->second)
+    {
+        godot::Dictionary renderer_stats;
+        renderer_stats["uploaded_bytes"] = renderer.uploaded_bytes;
+        renderer_stats["buffer_copies"] = renderer.buffer_copies;
+        stats[renderer.name] = renderer_stats;
+    }
+    return stats;
+}
+
+void FlecsWorld::reserve_renderer_capacity(godot::Node* renderer_node, int64_t instance_count)
+{
+    godot::Ref<godot::MultiMesh> multimesh;
+    if (godot::MultiMeshInstance2D* multimesh_instance_2d = godot::Object::cast_to<godot::MultiMeshInstance2D>(renderer_node))
+    {
+        multimesh = multimesh_instance_2d->get_multimesh();
+    }
+    else if (godot::MultiMeshInstance3D* multimesh_instance_3d = godot::Object::cast_to<godot::MultiMeshInstance3D>(renderer_node))
+    {
+        multimesh = multimesh_instance_3d->get_multimesh();
+    }
+
+    EntityRenderers* renderers = is_initialised ? world.try_get_mut<EntityRenderers>() : nullptr;
+    MultiMeshRenderer* renderer = nullptr;
+    if (multimesh.is_valid() && renderers != nullptr)
+    {
+        auto multimesh_renderers_it = renderers->renderers_by_type.find(RendererType::MultiMesh);
+        if (multimesh_renderers_it != renderers->renderers_by_type.end())
+        {
+            auto renderer_it = multimesh_renderers_it->second.find(multimesh->get_rid());
+            renderer = renderer_it != multimesh_renderers_it->second.end() ? &renderer_it->second : nullptr;
+        }
+    }
+    if (renderer == nullptr)
+    {
+        UtilityFunctions::push_warning("FlecsWorld::reserve_renderer_capacity: the node is not an entity renderer.");
+        return;
+    }
+
+    ::reserve_renderer_capacity(*renderer, static_cast<size_t>(std::max<int64_t>(instance_count, 0)));
+}
+
+godot::PackedVector2Array FlecsWorld::sample_renderer_positions(godot::Node* renderer_node, int max_samples) const
+{
+    godot::PackedVector2Array positions;
+    godot::MultiMeshInstance2D* multimesh_instance = godot::Object::cast_to<godot::MultiMeshInstance2D>(renderer_node);
+    const EntityRenderers* renderers = is_initialised ? world.try_get<EntityRenderers>() : nullptr;
+    if (multimesh_instance == nullptr || multimesh_instance->get_multimesh().is_null() || renderers == nullptr || max_samples <= 0)
+    {
+        return positions;
+    }
+    auto multimesh_renderers_it = renderers->renderers_by_type.find(RendererType::MultiMesh);
+    if (multimesh_renderers_it == renderers->renderers_by_type.end()) { return positions; }
+    auto renderer_it = multimesh_renderers_it->second.find(multimesh_instance->get_multimesh()->get_rid());
+    if (renderer_it == multimesh_renderers_it->second.end()) { return positions; }
+    const MultiMeshRenderer& renderer = renderer_it->second;
+
+    int64_t instance_count = 0;
+    for (const std::vector<flecs::query<>>* queries : { &renderer.instance_queries, &renderer.component_instance_queries })
+    {
+        for (const flecs::query<>& q : *queries)
+        {
+            instance_count += q.count();
+        }
+    }
+    const int64_t stride = std::max<int64_t>((instance_count + max_samples - 1) / max_samples, 1);
+
+    positions.resize(std::min<int64_t>(instance_count, max_samples));
+    godot::Vector2* positions_ptr = positions.ptrw();
+    int64_t sample_count = 0;
+    int64_t next_sample = 0;
+    int64_t entity_index = 0;
+    // `source` is the type of field 0: Transform2D, or Position2D for the translation-only entities
+    auto sample_instances = [&](const std::vector<flecs::query<>>& queries, auto source)
+    {
+        using SourceType = decltype(source);
+        for (const flecs::query<>& q : queries)
+        {
+            q.run([&](flecs::iter& it) {
+                while (it.next())
+                {
+                    auto origin_field = it.field<const SourceType>(0);
+                    const int64_t table_end = entity_index + static_cast<int64_t>(it.count());
+                    for (; next_sample < table_end && sample_count < positions.size(); next_sample += stride)
+                    {
+                        positions_ptr[sample_count++] = ::utilities::get_instance_origin(origin_field[static_cast<size_t>(next_sample - entity_index)]);
+                    }
+                    entity_index = table_end;
+                }
+            });
+        }
+    };
+    sample_instances(renderer.instance_queries, godot::Transform2D{});
+    sample_instances(renderer.component_instance_queries, Position2D{});
+    positions.resize(sample_count);
+    return positions;
+}
+
+godot::Dictionary FlecsWorld::get_system_timings() const
+{
+    godot::Dictionary timings;
+    for (const ::utilities::SystemTimingSummary& summary : system_timings.summarize())
+    {
+        godot::Dictionary system_timing;
+        system_timing["min_usec"] = summary.min_usec;
+        system_timing["mean_usec"] = summary.mean_usec;
+        system_timing["p99_usec"] = summary.p99_usec;
+        system_timing["max_usec"] = summary.max_usec;
+        timings[godot::String::utf8(summary.name.c_str())] = system_timing;
+    }
+    return timings;
+}
+
 void FlecsWorld::_notification(const int p_what)
 {
+    // Entering the tree comes before the children's _ready(), so the log also covers the singletons they set up
+    if (p_what == NOTIFICATION_ENTER_TREE && is_initialised && !godot::Engine::get_singleton()->is_editor_hint())
+    {
+        start_input_log_from_command_line();
+    }
+
     if (p_what == NOTIFICATION_READY)
     {
         setup_entity_renderers();
         update_physics_spaces();
+        if (is_initialised)
+        {
+            add_performance_monitors();
+        }
     }
 }
 
@@ -330,16 +706,14 @@ void FlecsWorld::set_singleton_component(const godot::String& component_name, co
         return;
     }
 
-    std::string name = component_name.utf8().get_data();
-    auto setter = singleton_setters.find(name);
-    if (setter != singleton_setters.end())
-    {
-        setter->second(data);
-    }
-    else
+    int64_t handle = get_singleton_handle(component_name);
+    if (handle < 0 || singleton_accessors[handle].setter == nullptr)
     {
         godot::UtilityFunctions::push_warning(godot::String("No setter for singleton component '") + component_name + "' found.");
+        return;
     }
+
+    write_singleton(handle, data);
 }
 
 godot::Variant FlecsWorld::get_singleton_component(const godot::String& component_name)
@@ -350,76 +724,812 @@ godot::Variant FlecsWorld::get_singleton_component(const godot::String& componen
         return godot::Variant();
     }
 
-    std::string name = component_name.utf8().get_data();
-    auto it = singleton_getters.find(name);
-    if (it == singleton_getters.end())
+    int64_t handle = get_singleton_handle(component_name);
+    if (handle < 0 || singleton_accessors[handle].getter == nullptr)
     {
         UtilityFunctions::push_warning(godot::String("No getter for singleton component '") + component_name + "' found.");
         return godot::Variant();
     }
 
-    return it->second();
+    return (*singleton_accessors[handle].getter)(world);
 }
 
-void FlecsWorld::progress(double delta)
+int64_t FlecsWorld::get_singleton_handle(const godot::String& component_name) const
+{
+    auto it = singleton_handles.find(component_name.utf8().get_data());
+    if (it == singleton_handles.end())
+    {
+        return -1;
+    }
+    return it->second;
+}
+
+void FlecsWorld::set_singleton_by_handle(int64_t handle, const godot::Variant& data)
 {
     if (!is_initialised)
     {
-        UtilityFunctions::push_warning(godot::String("FlecsWorld::progress was called before world was initialised"));
+        UtilityFunctions::push_warning(godot::String("FlecsWorld::set_singleton_by_handle was called before world was initialised"));
+        return;
+    }
+
+    if (handle < 0 || handle >= static_cast<int64_t>(singleton_accessors.size()) || singleton_accessors[handle].setter == nullptr)
+    {
+        UtilityFunctions::push_warning(godot::String("Invalid singleton setter handle ") + godot::String::num_int64(handle));
         return;
     }
 
-    world.progress(static_cast<ecs_ftime_t>(delta));
+    write_singleton(handle, data);
 }
 
-bool FlecsWorld::run_system(const godot::String& system_name, const godot::Dictionary& parameters)
+void FlecsWorld::write_singleton(int64_t handle, const godot::Variant& data)
 {
-    std::string name = system_name.utf8().get_data();
-
-    // Lookup the entity by name, then request a system handle from the world
-    // using that entity. This avoids matching the system_builder overload.
-    flecs::entity entity = world.lookup(name.c_str());
-    if (!entity.is_valid())
+    if (input_log_reader.is_open())
     {
-        return false;
+        return; // The replay owns the inputs
     }
-    flecs::system sys = world.system(entity);
-    if (!sys.is_valid())
+
+    if (input_log_writer.is_open())
     {
-        return false;
+        const godot::PackedByteArray bytes = UtilityFunctions::var_to_bytes(data);
+        input_log_writer.write_singleton(singleton_accessors[handle].component_name, bytes.ptr(), static_cast<size_t>(bytes.size()));
     }
 
-    if (parameters.is_empty())
+    (*singleton_accessors[handle].setter)(world, data);
+}
+
+godot::Variant FlecsWorld::get_singleton_by_handle(int64_t handle) const
+{
+    if (!is_initialised)
     {
-        sys.run();
+        UtilityFunctions::push_warning(godot::String("FlecsWorld::get_singleton_by_handle was called before world was initialised"));
+        return godot::Variant();
     }
-    else
+
+    if (handle < 0 || handle >= static_cast<int64_t>(singleton_accessors.size()) || singleton_accessors[handle].getter == nullptr)
     {
-        sys.run(0.0f, (void*)&parameters);
+        UtilityFunctions::push_warning(godot::String("Invalid singleton getter handle ") + godot::String::num_int64(handle));
+        return godot::Variant();
     }
-    return true;
+
+    return (*singleton_accessors[handle].getter)(world);
 }
 
-void FlecsWorld::_exit_tree()
+void FlecsWorld::progress(double delta)
 {
     if (!is_initialised)
     {
+        UtilityFunctions::push_warning(godot::String("FlecsWorld::progress was called before world was initialised"));
         return;
     }
 
-    is_initialised = false;
+    if (input_log_reader.is_open())
+    {
+        if (!read_replay_frame(delta))
+        {
+            stop_replay();
+            emit_signal("replay_finished");
+            return;
+        }
+    }
+    else if (input_log_writer.is_open())
+    {
+        input_log_writer.write_progress(delta);
+    }
+
+    advance(delta);
 }
 
+void FlecsWorld::advance(double delta)
+{
+    hand_over_physics_body_states();
 
-FlecsWorld::~FlecsWorld() {}
+    if (!fixed_timestep_enabled)
+    {
+        world.progress(static_cast<ecs_ftime_t>(delta));
+        render_entities(1.0f);
+        system_timings.sample_frame(world);
+        flush_godot_events();
+        return;
+    }
 
+    // Set before ticking so the snapshot systems capture the previous transforms from the first tick onwards
+    world.set<RenderInterpolation>({ true, 1.0f });
 
-void FlecsWorld::_bind_methods()
-{
-    ClassDB::bind_method(D_METHOD("progress", "delta"), &FlecsWorld::progress);
-    ClassDB::bind_method(D_METHOD("set_singleton_component", "component_name", "data"), &FlecsWorld::set_singleton_component);
+    const double tick_duration = 1.0 / simulation_tick_rate;
+    time_accumulator += delta;
+
+    int substeps = 0;
+    while (time_accumulator >= tick_duration && substeps < max_substeps)
+    {
+        world.progress(static_cast<ecs_ftime_t>(tick_duration));
+        time_accumulator -= tick_duration;
+        substeps++;
+    }
+
+    // Drop the backlog when the cap was hit, otherwise a slow frame makes every following frame slower (spiral of death).
+    // The simulation runs behind real time for that frame instead.
+    if (time_accumulator >= tick_duration)
+    {
+        time_accumulator = std::fmod(time_accumulator, tick_duration);
+    }
+
+    render_entities(static_cast<float>(time_accumulator / tick_duration));
+    system_timings.sample_frame(world);
+    flush_godot_events();
+}
+
+void FlecsWorld::render_entities(float interpolation_alpha)
+{
+    if (!entity_rendering_system.is_valid())
+    {
+        return;
+    }
+
+    world.set<RenderInterpolation>({ fixed_timestep_enabled, interpolation_alpha });
+
+    godot::Viewport* viewport = is_inside_tree() ? get_viewport() : nullptr;
+    godot::Camera3D* camera = viewport != nullptr ? viewport->get_camera_3d() : nullptr;
+    if (camera != nullptr)
+    {
+        const godot::Transform3D camera_transform = camera->get_global_transform();
+        world.set<DrawOrderCamera>({ camera_transform.origin, -camera_transform.basis.get_column(2) });
+    }
+
+    if (viewport != nullptr && viewport->get_camera_2d() != nullptr)
+    {
+        // The canvas transform is what the Camera2D sets, so its inverse maps the visible rect to canvas coordinates
+        world.set<CameraRect>({ viewport->get_canvas_transform().affine_inverse().xform(viewport->get_visible_rect()) });
+    }
+    if (viewport_culling_system.is_valid())
+    {
+        world.system(viewport_culling_system).run();
+    }
+
+    world.system(entity_rendering_system).run();
+}
+
+void FlecsWorld::flush_godot_events()
+{
+    GodotEventQueue* event_queue = world.try_get_mut<GodotEventQueue>();
+    if (!event_queue)
+    {
+        return;
+    }
+
+    for (GodotEventBatch& batch : event_queue->batches)
+    {
+        const int64_t event_count = static_cast<int64_t>(batch.size());
+        if (event_count == 0)
+        {
+            continue;
+        }
+
+        auto subscribers = event_subscribers.find(batch.name);
+        if (subscribers != event_subscribers.end() && !subscribers->second.empty())
+        {
+            godot::PackedVector2Array positions;
+            positions.resize(event_count);
+            std::memcpy(positions.ptrw(), batch.positions.data(), sizeof(godot::Vector2) * event_count);
+
+            godot::PackedInt32Array prefab_indices;
+            prefab_indices.resize(event_count);
+            std::memcpy(prefab_indices.ptrw(), batch.prefab_indices.data(), sizeof(int32_t) * event_count);
+
+            godot::PackedFloat32Array amounts;
+            amounts.resize(event_count);
+            std::memcpy(amounts.ptrw(), batch.amounts.data(), sizeof(float) * event_count);
+
+            // Callables may (un)subscribe while being called, so iterate over a copy
+            const std::vector<godot::Callable> callables = subscribers->second;
+            for (const godot::Callable& callable : callables)
+            {
+                if (callable.is_valid())
+                {
+                    callable.call(positions, prefab_indices, amounts);
+                }
+            }
+
+            // Drop subscribers whose objects were freed
+            std::vector<godot::Callable>& current_subscribers = event_subscribers[batch.name];
+            current_subscribers.erase(
+                std::remove_if(current_subscribers.begin(), current_subscribers.end(), [](const godot::Callable& callable) { return !callable.is_valid(); }),
+                current_subscribers.end());
+        }
+
+        batch.clear();
+    }
+}
+
+void FlecsWorld::subscribe_events(const godot::String& event_name, const godot::Callable& callable)
+{
+    if (!callable.is_valid())
+    {
+        UtilityFunctions::push_warning(godot::String("FlecsWorld::subscribe_events: invalid callable for event '") + event_name + "'.");
+        return;
+    }
+
+    std::vector<godot::Callable>& subscribers = event_subscribers[event_name.utf8().get_data()];
+    if (std::find(subscribers.begin(), subscribers.end(), callable) == subscribers.end())
+    {
+        subscribers.push_back(callable);
+    }
+}
+
+void FlecsWorld::unsubscribe_events(const godot::String& event_name, const godot::Callable& callable)
+{
+    auto subscribers = event_subscribers.find(event_name.utf8().get_data());
+    if (subscribers == event_subscribers.end())
+    {
+        return;
+    }
+
+    subscribers->second.erase(std::remove(subscribers->second.begin(), subscribers->second.end(), callable), subscribers->second.end());
+}
+
+godot::PackedStringArray FlecsWorld::get_event_prefab_names() const
+{
+    godot::PackedStringArray prefab_names;
+    const GodotEventQueue* event_queue = world.try_get<GodotEventQueue>();
+    if (event_queue)
+    {
+        for (const std::string& prefab_name : event_queue->prefab_names)
+        {
+            prefab_names.push_back(godot::String::utf8(prefab_name.c_str()));
+        }
+    }
+    return prefab_names;
+}
+
+void FlecsWorld::set_fixed_timestep_enabled(bool enabled)
+{
+    fixed_timestep_enabled = enabled;
+    time_accumulator = 0.0;
+}
+
+bool FlecsWorld::is_fixed_timestep_enabled() const
+{
+    return fixed_timestep_enabled;
+}
+
+void FlecsWorld::set_simulation_tick_rate(double tick_rate)
+{
+    if (tick_rate <= 0.0)
+    {
+        UtilityFunctions::push_warning(godot::String("FlecsWorld: simulation_tick_rate must be positive, keeping ") + godot::String::num(simulation_tick_rate));
+        return;
+    }
+    simulation_tick_rate = tick_rate;
+}
+
+double FlecsWorld::get_simulation_tick_rate() const
+{
+    return simulation_tick_rate;
+}
+
+void FlecsWorld::set_max_substeps(int substeps)
+{
+    max_substeps = substeps < 1 ? 1 : substeps;
+}
+
+int FlecsWorld::get_max_substeps() const
+{
+    return max_substeps;
+}
+
+bool FlecsWorld::run_system(const godot::String& system_name, const godot::Dictionary& parameters)
+{
+    int64_t handle = get_system_handle(system_name);
+    if (handle < 0)
+    {
+        return false;
+    }
+    return log_and_run_system(handle, parameters, false);
+}
+
+int64_t FlecsWorld::get_system_handle(const godot::String& system_name)
+{
+    std::string name = system_name.utf8().get_data();
+
+    auto it = system_handles.find(name);
+    if (it != system_handles.end())
+    {
+        return it->second;
+    }
+
+    // Lookup the entity by name and make sure it is a system; world.system(entity) would match the system_builder overload
+    // when given the name directly.
+    flecs::entity entity = world.lookup(name.c_str());
+    if (!entity.is_valid() || !entity.has(flecs::System))
+    {
+        return -1;
+    }
+
+    SystemAccessor accessor;
+    accessor.name = name;
+    accessor.system = entity;
+    const auto& factories = get_system_parameter_factories();
+    auto factory = factories.find(name);
+    if (factory != factories.end())
+    {
+        accessor.parameters = factory->second();
+        accessor.run_parameters = factory->second();
+    }
+
+    int64_t handle = static_cast<int64_t>(system_accessors.size());
+    system_accessors.push_back(std::move(accessor));
+    system_handles.emplace(name, handle);
+    return handle;
+}
+
+bool FlecsWorld::set_system_parameters(int64_t handle, const godot::Dictionary& parameters)
+{
+    if (handle < 0 || handle >= static_cast<int64_t>(system_accessors.size()))
+    {
+        UtilityFunctions::push_warning(godot::String("Invalid system handle ") + godot::String::num_int64(handle));
+        return false;
+    }
+
+    if (!system_accessors[handle].parameters)
+    {
+        UtilityFunctions::push_warning("FlecsWorld::set_system_parameters: system has no native parameter type, pass the parameters to run_system_by_handle instead.");
+        return false;
+    }
+
+    if (input_log_reader.is_open())
+    {
+        return false; // The replay owns the inputs
+    }
+
+    if (input_log_writer.is_open())
+    {
+        const godot::PackedByteArray bytes = UtilityFunctions::var_to_bytes(parameters);
+        input_log_writer.write_system_parameters(system_accessors[handle].name, bytes.ptr(), static_cast<size_t>(bytes.size()));
+    }
+
+    return decode_system_parameters(handle, parameters);
+}
+
+bool FlecsWorld::decode_system_parameters(int64_t handle, const godot::Dictionary& parameters)
+{
+    SystemAccessor& accessor = system_accessors[handle];
+    accessor.has_set_parameters = accessor.parameters->decode(world, parameters);
+    return accessor.has_set_parameters;
+}
+
+bool FlecsWorld::run_system_by_handle(int64_t handle, const godot::Dictionary& parameters)
+{
+    if (handle < 0 || handle >= static_cast<int64_t>(system_accessors.size()))
+    {
+        UtilityFunctions::push_warning(godot::String("Invalid system handle ") + godot::String::num_int64(handle));
+        return false;
+    }
+    return log_and_run_system(handle, parameters, parameters.is_empty());
+}
+
+bool FlecsWorld::log_and_run_system(int64_t handle, const godot::Dictionary& parameters, bool use_set_parameters)
+{
+    if (input_log_reader.is_open())
+    {
+        return false; // The replay owns the inputs
+    }
+
+    if (input_log_writer.is_open() && use_set_parameters)
+    {
+        input_log_writer.write_run_system_with_set_parameters(system_accessors[handle].name);
+    }
+    else if (input_log_writer.is_open())
+    {
+        const godot::PackedByteArray bytes = UtilityFunctions::var_to_bytes(parameters);
+        input_log_writer.write_run_system(system_accessors[handle].name, bytes.ptr(), static_cast<size_t>(bytes.size()));
+    }
+
+    return use_set_parameters ? run_system_with_set_parameters(handle) : run_system_with_parameters(handle, parameters);
+}
+
+// Runs the system with parameters for this run only. Without any, the system runs without parameters and reports that itself.
+bool FlecsWorld::run_system_with_parameters(int64_t handle, const godot::Dictionary& parameters)
+{
+    SystemAccessor& accessor = system_accessors[handle];
+    flecs::system sys = world.system(accessor.system);
+
+    if (parameters.is_empty())
+    {
+        sys.run();
+        return true;
+    }
+
+    void* system_parameters = (void*)&parameters;
+    if (accessor.run_parameters)
+    {
+        if (!accessor.run_parameters->decode(world, parameters))
+        {
+            return false;
+        }
+        system_parameters = accessor.run_parameters->get();
+    }
+
+    sys.run(0.0f, system_parameters);
+    return true;
+}
+
+bool FlecsWorld::run_system_with_set_parameters(int64_t handle)
+{
+    SystemAccessor& accessor = system_accessors[handle];
+    flecs::system sys = world.system(accessor.system);
+
+    if (accessor.parameters && accessor.has_set_parameters)
+    {
+        sys.run(0.0f, accessor.parameters->get());
+    }
+    else
+    {
+        sys.run();
+    }
+    return true;
+}
+
+int64_t FlecsWorld::spawn_batch(const godot::StringName& prefab_name, const godot::PackedVector2Array& positions, const godot::PackedFloat32Array& rotations, const godot::PackedVector2Array& scales)
+{
+    if (!is_initialised)
+    {
+        UtilityFunctions::push_warning(godot::String("FlecsWorld::spawn_batch was called before world was initialised"));
+        return 0;
+    }
+
+    if (input_log_reader.is_open())
+    {
+        return 0; // The replay owns the inputs
+    }
+
+    const flecs::entity prefab = resolve_prefab(prefab_name);
+    if (!prefab)
+    {
+        UtilityFunctions::push_warning(godot::String("FlecsWorld::spawn_batch: prefab '") + prefab_name + "' not found.");
+        return 0;
+    }
+    if ((!rotations.is_empty() && rotations.size() != positions.size()) || (!scales.is_empty() && scales.size() != positions.size()))
+    {
+        UtilityFunctions::push_warning(godot::String("FlecsWorld::spawn_batch: rotations and scales must be empty or as long as positions."));
+        return 0;
+    }
+
+    if (input_log_writer.is_open())
+    {
+        const godot::PackedByteArray bytes = UtilityFunctions::var_to_bytes(godot::Array::make(positions, rotations, scales));
+        input_log_writer.write_spawn_batch(godot::String(prefab_name).utf8().get_data(), bytes.ptr(), static_cast<size_t>(bytes.size()));
+    }
+
+    return spawn_prefab_batch(prefab, positions, rotations, scales);
+}
+
+flecs::entity FlecsWorld::resolve_prefab(const godot::StringName& prefab_name)
+{
+    auto found = prefabs_by_name.find(prefab_name);
+    if (found != prefabs_by_name.end() && found->second.is_alive())
+    {
+        return found->second;
+    }
+
+    const flecs::entity prefab = world.lookup(godot::String(prefab_name).utf8().get_data());
+    if (!prefab || !prefab.has(flecs::Prefab))
+    {
+        return flecs::entity();
+    }
+    prefabs_by_name[prefab_name] = prefab;
+    return prefab;
+}
+
+int64_t FlecsWorld::spawn_prefab_batch(flecs::entity prefab, const godot::PackedVector2Array& positions, const godot::PackedFloat32Array& rotations, const godot::PackedVector2Array& scales)
+{
+    return spawn_prefab_batch_2d(
+        world,
+        prefab,
+        positions.ptr(),
+        rotations.is_empty() ? nullptr : rotations.ptr(),
+        scales.is_empty() ? nullptr : scales.ptr(),
+        static_cast<int32_t>(positions.size()));
+}
+
+bool FlecsWorld::start_recording(const godot::String& path)
+{
+    stop_replay();
+
+    const godot::String global_path = godot::ProjectSettings::get_singleton()->globalize_path(path);
+    if (!input_log_writer.open(global_path.utf8().get_data()))
+    {
+        UtilityFunctions::push_error(godot::String("FlecsWorld: could not open input log for writing: ") + global_path);
+        return false;
+    }
+    return true;
+}
+
+void FlecsWorld::stop_recording()
+{
+    input_log_writer.close();
+}
+
+bool FlecsWorld::is_recording() const
+{
+    return input_log_writer.is_open();
+}
+
+bool FlecsWorld::start_replay(const godot::String& path)
+{
+    stop_recording();
+
+    const godot::String global_path = godot::ProjectSettings::get_singleton()->globalize_path(path);
+    if (!input_log_reader.open(global_path.utf8().get_data()))
+    {
+        UtilityFunctions::push_error(godot::String("FlecsWorld: could not open input log for replay: ") + global_path);
+        return false;
+    }
+    return true;
+}
+
+void FlecsWorld::stop_replay()
+{
+    input_log_reader.close();
+}
+
+bool FlecsWorld::is_replaying() const
+{
+    return input_log_reader.is_open();
+}
+
+int64_t FlecsWorld::replay_to_end()
+{
+    if (!is_initialised || !input_log_reader.is_open())
+    {
+        return 0;
+    }
+
+    int64_t frame_count = 0;
+    double delta = 0.0;
+    while (read_replay_frame(delta))
+    {
+        advance(delta);
+        frame_count++;
+    }
+
+    stop_replay();
+    emit_signal("replay_finished");
+    return frame_count;
+}
+
+godot::PackedByteArray FlecsWorld::snapshot()
+{
+    if (!is_initialised)
+    {
+        UtilityFunctions::push_warning(godot::String("FlecsWorld::snapshot was called before world was initialised"));
+        return godot::PackedByteArray();
+    }
+
+    const std::vector<uint8_t> bytes = utilities::WorldSnapshot::capture(world);
+    godot::PackedByteArray snapshot_data;
+    snapshot_data.resize(static_cast<int64_t>(bytes.size()));
+    std::memcpy(snapshot_data.ptrw(), bytes.data(), bytes.size());
+
+    last_snapshot = snapshot_data;
+    return snapshot_data;
+}
+
+bool FlecsWorld::restore(const godot::PackedByteArray& snapshot_data)
+{
+    if (!is_initialised)
+    {
+        UtilityFunctions::push_warning(godot::String("FlecsWorld::restore was called before world was initialised"));
+        return false;
+    }
+
+    std::string error;
+    if (!utilities::WorldSnapshot::restore(world, snapshot_data.ptr(), static_cast<size_t>(snapshot_data.size()), error))
+    {
+        UtilityFunctions::push_error(godot::String("FlecsWorld::restore: ") + error.c_str());
+        return false;
+    }
+
+    // Start the restored state on a tick boundary instead of carrying over the old partial tick
+    time_accumulator = 0.0;
+    return true;
+}
+
+bool FlecsWorld::reset_to_snapshot()
+{
+    if (last_snapshot.is_empty())
+    {
+        UtilityFunctions::push_warning("FlecsWorld::reset_to_snapshot: no snapshot has been taken yet");
+        return false;
+    }
+    return restore(last_snapshot);
+}
+
+int64_t FlecsWorld::sync_random_seed(int64_t seed)
+{
+    if (input_log_writer.is_open())
+    {
+        input_log_writer.write_random_seed(seed);
+        return seed;
+    }
+
+    if (input_log_reader.is_open())
+    {
+        // Seeds are usually taken while the scene sets up, before the first frame. Apply the inputs logged ahead of the seed
+        // now (they would have been applied before the first frame anyway), but don't read past the next frame.
+        utilities::InputRecordType next_type;
+        utilities::InputRecord record;
+        while (input_log_reader.peek_type(next_type) && next_type != utilities::InputRecordType::Progress && input_log_reader.next(record))
+        {
+            if (record.type == utilities::InputRecordType::RandomSeed)
+            {
+                return record.seed;
+            }
+            apply_replay_input(record);
+        }
+    }
+
+    return seed;
+}
+
+// Applies the logged inputs up to the next frame and returns that frame's delta. False at the end of the log.
+bool FlecsWorld::read_replay_frame(double& delta)
+{
+    utilities::InputRecord record;
+    while (input_log_reader.next(record))
+    {
+        if (record.type == utilities::InputRecordType::Progress)
+        {
+            delta = record.delta;
+            return true;
+        }
+        apply_replay_input(record);
+    }
+    return false;
+}
+
+void FlecsWorld::apply_replay_input(const utilities::InputRecord& record)
+{
+    if (record.type == utilities::InputRecordType::RandomSeed)
+    {
+        UtilityFunctions::seed(record.seed);
+        return;
+    }
+
+    if (record.name == nullptr)
+    {
+        return;
+    }
+
+    godot::PackedByteArray bytes;
+    bytes.resize(static_cast<int64_t>(record.size));
+    if (record.size > 0)
+    {
+        std::memcpy(bytes.ptrw(), record.data, record.size);
+    }
+    const godot::Variant data = UtilityFunctions::bytes_to_var(bytes);
+    const godot::String name = godot::String::utf8(record.name->c_str());
+
+    if (record.type == utilities::InputRecordType::SingletonWrite)
+    {
+        const int64_t handle = get_singleton_handle(name);
+        if (handle >= 0 && singleton_accessors[handle].setter != nullptr)
+        {
+            (*singleton_accessors[handle].setter)(world, data);
+        }
+        return;
+    }
+
+    if (record.type == utilities::InputRecordType::SpawnBatch)
+    {
+        const godot::Array batch = data;
+        const flecs::entity prefab = resolve_prefab(name);
+        if (prefab && batch.size() == 3)
+        {
+            spawn_prefab_batch(prefab, batch[0], batch[1], batch[2]);
+        }
+        return;
+    }
+
+    const int64_t handle = get_system_handle(name);
+    if (handle < 0)
+    {
+        return;
+    }
+    if (record.type == utilities::InputRecordType::RunSystem)
+    {
+        run_system_with_parameters(handle, data);
+    }
+    else if (record.type == utilities::InputRecordType::RunSystemWithSetParameters)
+    {
+        run_system_with_set_parameters(handle);
+    }
+    else if (record.type == utilities::InputRecordType::SetSystemParameters && system_accessors[handle].parameters)
+    {
+        decode_system_parameters(handle, data);
+    }
+}
+
+void FlecsWorld::start_input_log_from_command_line()
+{
+    const godot::PackedStringArray user_args = godot::OS::get_singleton()->get_cmdline_user_args();
+    for (int64_t arg_idx = 0; arg_idx < user_args.size(); ++arg_idx)
+    {
+        const godot::String& arg = user_args[arg_idx];
+        if (arg.begins_with("--flecs-record="))
+        {
+            start_recording(arg.trim_prefix("--flecs-record="));
+        }
+        else if (arg.begins_with("--flecs-replay="))
+        {
+            start_replay(arg.trim_prefix("--flecs-replay="));
+        }
+    }
+}
+
+void FlecsWorld::_exit_tree()
+{
+    if (!is_initialised)
+    {
+        return;
+    }
+
+    remove_performance_monitors();
+    stop_recording();
+    stop_replay();
+
+    is_initialised = false;
+}
+
+
+FlecsWorld::~FlecsWorld() {}
+
+
+void FlecsWorld::_bind_methods()
+{
+    ClassDB::bind_method(D_METHOD("progress", "delta"), &FlecsWorld::progress);
+    ClassDB::bind_method(D_METHOD("set_singleton_component", "component_name", "data"), &FlecsWorld::set_singleton_component);
     ClassDB::bind_method(D_METHOD("get_singleton_component", "component_name"), &FlecsWorld::get_singleton_component);
+    ClassDB::bind_method(D_METHOD("get_singleton_handle", "component_name"), &FlecsWorld::get_singleton_handle);
+    ClassDB::bind_method(D_METHOD("set_singleton_by_handle", "handle", "data"), &FlecsWorld::set_singleton_by_handle);
+    ClassDB::bind_method(D_METHOD("get_singleton_by_handle", "handle"), &FlecsWorld::get_singleton_by_handle);
     ClassDB::bind_method(D_METHOD("run_system", "system_name", "data"), &FlecsWorld::run_system, DEFVAL(godot::Dictionary()));
+    ClassDB::bind_method(D_METHOD("get_system_handle", "system_name"), &FlecsWorld::get_system_handle);
+    ClassDB::bind_method(D_METHOD("run_system_by_handle", "handle", "data"), &FlecsWorld::run_system_by_handle, DEFVAL(godot::Dictionary()));
+    ClassDB::bind_method(D_METHOD("set_system_parameters", "handle", "data"), &FlecsWorld::set_system_parameters);
+    ClassDB::bind_method(D_METHOD("spawn_batch", "prefab_name", "positions", "rotations", "scales"), &FlecsWorld::spawn_batch, DEFVAL(godot::PackedFloat32Array()), DEFVAL(godot::PackedVector2Array()));
+
+    ClassDB::bind_method(D_METHOD("set_fixed_timestep_enabled", "enabled"), &FlecsWorld::set_fixed_timestep_enabled);
+    ClassDB::bind_method(D_METHOD("is_fixed_timestep_enabled"), &FlecsWorld::is_fixed_timestep_enabled);
+    ClassDB::bind_method(D_METHOD("set_simulation_tick_rate", "tick_rate"), &FlecsWorld::set_simulation_tick_rate);
+    ClassDB::bind_method(D_METHOD("get_simulation_tick_rate"), &FlecsWorld::get_simulation_tick_rate);
+    ClassDB::bind_method(D_METHOD("set_max_substeps", "substeps"), &FlecsWorld::set_max_substeps);
+    ClassDB::bind_method(D_METHOD("get_max_substeps"), &FlecsWorld::get_max_substeps);
+
+    ClassDB::bind_method(D_METHOD("snapshot"), &FlecsWorld::snapshot);
+    ClassDB::bind_method(D_METHOD("restore", "snapshot"), &FlecsWorld::restore);
+    ClassDB::bind_method(D_METHOD("reset_to_snapshot"), &FlecsWorld::reset_to_snapshot);
+
+    ClassDB::bind_method(D_METHOD("start_recording", "path"), &FlecsWorld::start_recording);
+    ClassDB::bind_method(D_METHOD("stop_recording"), &FlecsWorld::stop_recording);
+    ClassDB::bind_method(D_METHOD("is_recording"), &FlecsWorld::is_recording);
+    ClassDB::bind_method(D_METHOD("start_replay", "path"), &FlecsWorld::start_replay);
+    ClassDB::bind_method(D_METHOD("stop_replay"), &FlecsWorld::stop_replay);
+    ClassDB::bind_method(D_METHOD("is_replaying"), &FlecsWorld::is_replaying);
+    ClassDB::bind_method(D_METHOD("replay_to_end"), &FlecsWorld::replay_to_end);
+    ClassDB::bind_method(D_METHOD("sync_random_seed", "seed"), &FlecsWorld::sync_random_seed);
+
+    ClassDB::bind_method(D_METHOD("get_system_timings"), &FlecsWorld::get_system_timings);
+    ClassDB::bind_method(D_METHOD("get_render_upload_stats"), &FlecsWorld::get_render_upload_stats);
+    ClassDB::bind_method(D_METHOD("sample_renderer_positions", "renderer_node", "max_samples"), &FlecsWorld::sample_renderer_positions);
+    ClassDB::bind_method(D_METHOD("reserve_renderer_capacity", "renderer_node", "instance_count"), &FlecsWorld::reserve_renderer_capacity);
+    ClassDB::bind_method(D_METHOD("subscribe_events", "event_name", "callable"), &FlecsWorld::subscribe_events);
+    ClassDB::bind_method(D_METHOD("unsubscribe_events", "event_name", "callable"), &FlecsWorld::unsubscribe_events);
+    ClassDB::bind_method(D_METHOD("get_event_prefab_names"), &FlecsWorld::get_event_prefab_names);
+
+    ADD_GROUP("Fixed Timestep", "");
+    ADD_PROPERTY(godot::PropertyInfo(godot::Variant::BOOL, "fixed_timestep_enabled"), "set_fixed_timestep_enabled", "is_fixed_timestep_enabled");
+    ADD_PROPERTY(godot::PropertyInfo(godot::Variant::FLOAT, "simulation_tick_rate", godot::PROPERTY_HINT_RANGE, "1,240,1,suffix:Hz"), "set_simulation_tick_rate", "get_simulation_tick_rate");
+    ADD_PROPERTY(godot::PropertyInfo(godot::Variant::INT, "max_substeps", godot::PROPERTY_HINT_RANGE, "1,16,1"), "set_max_substeps", "get_max_substeps");
 
+    ADD_SIGNAL(godot::MethodInfo("replay_finished"));
     ADD_SIGNAL(godot::MethodInfo("flecs_signal_emitted", godot::PropertyInfo(godot::Variant::STRING_NAME, "name"), godot::PropertyInfo(godot::Variant::DICTIONARY, "data")));
 }
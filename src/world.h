@@ -1,14 +1,34 @@
 #pragma once
 
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <functional>
+#include <vector>
 
 #include <godot_cpp/classes/node.hpp>
+#include <godot_cpp/classes/physics_direct_body_state2d.hpp>
+#include <godot_cpp/classes/physics_direct_body_state3d.hpp>
+#include <godot_cpp/variant/callable.hpp>
 #include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/packed_float32_array.hpp>
+#include <godot_cpp/variant/packed_string_array.hpp>
+#include <godot_cpp/variant/packed_vector2_array.hpp>
+#include <godot_cpp/variant/rid.hpp>
+#include <godot_cpp/variant/string_name.hpp>
 
 #include <flecs.h>
 
+#include "src/components/physics.h"
+#include "src/flecs_singleton_registry.h"
+#include "src/system_parameter_registry.h"
+#include "src/utilities/godot_hashes.h"
+#include "src/utilities/input_log.h"
+#include "src/utilities/world_snapshot.h"
+#include "src/utilities/system_timings.h"
+
 using godot::Dictionary;
 using godot::Node;
 
@@ -23,8 +43,79 @@ public:
     void progress(double delta); // To be called every frame from GDScript attached to the FlecsWorld node. Make sure ecs_ftime_t matches the type of delta.
     void set_singleton_component(const godot::String& component_name, const godot::Variant& data);
     godot::Variant get_singleton_component(const godot::String& component_name);
+
+    // Handle-based singleton access for per-frame calls. Resolve the handle once (e.g. in _ready) and reuse it, which skips
+    // the UTF-8 conversion and name lookup of set/get_singleton_component. Returns -1 for unknown names.
+    int64_t get_singleton_handle(const godot::String& component_name) const;
+    void set_singleton_by_handle(int64_t handle, const godot::Variant& data);
+    godot::Variant get_singleton_by_handle(int64_t handle) const;
     bool run_system(const godot::String& system_name, const godot::Dictionary& parameters); // For triggering on-demand (kind: 0) Flecs systems from GDScript
 
+    // Handle-based system runs. Systems that declare a native parameter type (see system_parameter_registry.h) get the
+    // Dictionary decoded into it. run_system_by_handle() without a Dictionary runs with the parameters last set through
+    // set_system_parameters(), so repeated calls with the same parameters decode them once. Returns -1 for unknown names.
+    int64_t get_system_handle(const godot::String& system_name);
+    bool run_system_by_handle(int64_t handle, const godot::Dictionary& parameters);
+    bool set_system_parameters(int64_t handle, const godot::Dictionary& parameters);
+
+    // Spawns positions.size() instances of a 2D prefab in one structural change: the entities are created in bulk, with their
+    // Position2D (and Rotation2D, Scale2D and transforms, unless the prefab is TranslationOnly2D) columns written directly.
+    // rotations and scales are optional, per instance; without them the instances keep the prefab's. Returns the number spawned.
+    int64_t spawn_batch(const godot::StringName& prefab_name, const godot::PackedVector2Array& positions, const godot::PackedFloat32Array& rotations, const godot::PackedVector2Array& scales);
+
+    // Fixed-timestep mode. When enabled, progress() accumulates the frame delta and advances the simulation in ticks of
+    // 1 / simulation_tick_rate seconds (at most max_substeps per frame). The renderer blends the last two ticks for display.
+    void set_fixed_timestep_enabled(bool enabled);
+    bool is_fixed_timestep_enabled() const;
+    void set_simulation_tick_rate(double tick_rate);
+    double get_simulation_tick_rate() const;
+    void set_max_substeps(int substeps);
+    int get_max_substeps() const;
+
+    // Batched events queued by systems on the GodotEventQueue singleton. Once per frame, after progress(), every callable
+    // subscribed to an event type is called once with (positions: PackedVector2Array, prefab_indices: PackedInt32Array, amounts: PackedFloat32Array).
+    // Prefab indices refer to get_event_prefab_names().
+    void subscribe_events(const godot::String& event_name, const godot::Callable& callable);
+    void unsubscribe_events(const godot::String& event_name, const godot::Callable& callable);
+    godot::PackedStringArray get_event_prefab_names() const;
+
+    // Input recording and replay. While recording, every progress() delta, singleton write, system run and recorded random seed
+    // is appended to a binary log. While replaying, progress() takes its delta and inputs from the log instead, and writes from
+    // GDScript are ignored, so a recorded session reproduces the same crowd. Replays must start from the same freshly loaded scene
+    // as the recording; `-- --flecs-record=<path>` / `-- --flecs-replay=<path>` on the command line start either when the world enters the tree.
+    bool start_recording(const godot::String& path);
+    void stop_recording();
+    bool is_recording() const;
+    bool start_replay(const godot::String& path);
+    void stop_replay();
+    bool is_replaying() const;
+    int64_t replay_to_end(); // Runs the rest of the replay back to back and returns the number of frames, for use as a profiling workload
+    // Seed for game code that uses the global RNG: returns `seed` and logs it while recording, and returns the logged seed while
+    // replaying. Usage: seed(world.sync_random_seed(randi()))
+    int64_t sync_random_seed(int64_t seed);
+
+    // Snapshots of all prefab instances (see utilities::WorldSnapshot) for restarting a stage without reloading the scene.
+    // snapshot() also keeps the snapshot so reset_to_snapshot() can restore it later. Restoring deletes the current instances
+    // in bulk and re-creates the snapshot's entities table by table; registrations, scripts, tables and queries stay as they are.
+    godot::PackedByteArray snapshot();
+    bool restore(const godot::PackedByteArray& snapshot_data);
+    bool reset_to_snapshot();
+
+    // Per-system timings over the last frames, keyed by system name: { "min_usec", "mean_usec", "p99_usec", "max_usec" }
+    godot::Dictionary get_system_timings() const;
+
+    // MultiMesh buffer uploads of the last rendered frame, keyed by renderer node name: { "uploaded_bytes", "buffer_copies" }.
+    // uploaded_bytes is 0 for renderers whose upload was skipped; buffer_copies counts copy-on-write copies since setup.
+    godot::Dictionary get_render_upload_stats() const;
+
+    // Up to max_samples positions of the entities drawn by a MultiMeshInstance2D renderer node, evenly strided over all of them
+    // and including culled ones. For overviews such as a minimap, instead of reading the MultiMesh buffer back.
+    godot::PackedVector2Array sample_renderer_positions(godot::Node* renderer_node, int max_samples) const;
+
+    // Grows the MultiMesh of a renderer node to at least instance_count instances right away. Renderers also grow on their own
+    // (doubling) when more entities match than fit, but that reallocates during a frame; reserving ahead of a spawn wave doesn't.
+    void reserve_renderer_capacity(godot::Node* renderer_node, int64_t instance_count);
+
     // Virtual methods overridden from Node
     void _exit_tree() override;
 
@@ -38,8 +129,71 @@ protected:
 private:
     flecs::world world;
     bool is_initialised = false;
-    std::unordered_map<std::string, std::function<void(const godot::Variant&)>> singleton_setters;
-    std::unordered_map<std::string, std::function<godot::Variant(void)>> singleton_getters;
+    bool fixed_timestep_enabled = false;
+    double simulation_tick_rate = 60.0;
+    int max_substeps = 4;
+    double time_accumulator = 0.0;
+    flecs::entity entity_rendering_system;
+    flecs::entity viewport_culling_system;
+    utilities::SystemTimings system_timings;
+    std::vector<godot::StringName> performance_monitor_ids;
+
+    // Flat table of singleton accessors indexed by handle. The pointers refer to the global registry's entries,
+    // which live for the lifetime of the library.
+    struct SingletonAccessor
+    {
+        std::string component_name;
+        const FlecsSingletonSetter* setter;
+        const FlecsSingletonGetter* getter;
+    };
+    std::vector<SingletonAccessor> singleton_accessors;
+    std::unordered_map<std::string, int64_t> singleton_handles;
+    std::unordered_map<std::string, std::vector<godot::Callable>> event_subscribers;
+
+    // On-demand systems resolved through get_system_handle(), indexed by handle
+    struct SystemAccessor
+    {
+        std::string name;
+        flecs::entity system;
+        std::unique_ptr<SystemParameterBlock> parameters; // From set_system_parameters(). Null when the system takes the raw Dictionary
+        std::unique_ptr<SystemParameterBlock> run_parameters; // Decoded for a single run, so they don't replace the set ones
+        bool has_set_parameters = false;
+    };
+    std::vector<SystemAccessor> system_accessors;
+    std::unordered_map<std::string, int64_t> system_handles;
+    std::unordered_map<godot::StringName, flecs::entity> prefabs_by_name; // Resolved by spawn_batch()
+    godot::Callable physics_body_state_sync_2d; // Referred to by the PhysicsBodyStates2D/3D singletons
+    godot::Callable physics_body_state_sync_3d;
+    // Filled by the state sync callbacks, which run on the physics thread when physics runs on a separate thread. Handed to
+    // the PhysicsBodyStates2D/3D singletons at the start of each frame.
+    std::mutex received_body_states_mutex;
+    std::vector<PhysicsBodyState2D> received_body_states_2d;
+    std::vector<PhysicsBodyState3D> received_body_states_3d;
+    godot::PackedByteArray last_snapshot;
+    utilities::InputLogWriter input_log_writer;
+    utilities::InputLogReader input_log_reader;
+    void advance(double delta);
+    void write_singleton(int64_t handle, const godot::Variant& data);
+    bool decode_system_parameters(int64_t handle, const godot::Dictionary& parameters);
+    bool log_and_run_system(int64_t handle, const godot::Dictionary& parameters, bool use_set_parameters);
+    bool run_system_with_parameters(int64_t handle, const godot::Dictionary& parameters);
+    bool run_system_with_set_parameters(int64_t handle);
+    bool read_replay_frame(double& delta);
+    void apply_replay_input(const utilities::InputRecord& record);
+    flecs::entity resolve_prefab(const godot::StringName& prefab_name);
+    int64_t spawn_prefab_batch(flecs::entity prefab, const godot::PackedVector2Array& positions, const godot::PackedFloat32Array& rotations, const godot::PackedVector2Array& scales);
+    void start_input_log_from_command_line();
     void setup_entity_renderers();
     void update_physics_spaces();
+    void render_entities(float interpolation_alpha);
+    void build_singleton_accessors();
+    void flush_godot_events();
+    void add_performance_monitors();
+    void remove_performance_monitors();
+    double get_system_frame_usec(int system_index) const; // Performance monitor callback
+    int64_t get_renderer_uploaded_bytes(const godot::RID& renderer_rid) const; // Performance monitor callback
+    // Physics body state sync callbacks, bound to the body's entity id. Thread-safe, they don't touch the world.
+    void queue_physics_body_state_2d(godot::PhysicsDirectBodyState2D* state, int64_t entity_id);
+    void queue_physics_body_state_3d(godot::PhysicsDirectBodyState3D* state, int64_t entity_id);
+    void hand_over_physics_body_states();
 };